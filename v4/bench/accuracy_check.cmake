@@ -0,0 +1,25 @@
+# accuracy_check target: runs ocr_accuracy against the last passing run's
+# ocr_accuracy.json (when there is one) and keeps this run as the next
+# baseline only if it passed, so a regression can't become the reference.
+#
+#   cmake -DOCR_ACCURACY=<exe> -DBASELINE=<json> -P accuracy_check.cmake
+
+set(candidate "${BASELINE}.new")
+set(args --json "${candidate}")
+if (EXISTS "${BASELINE}")
+    list(APPEND args --baseline "${BASELINE}")
+else()
+    message(STATUS "No ${BASELINE} yet, this run becomes the baseline")
+endif()
+
+execute_process(
+    COMMAND "${OCR_ACCURACY}" ${args}
+    RESULT_VARIABLE result
+)
+
+if (NOT result EQUAL 0)
+    file(REMOVE "${candidate}")
+    message(FATAL_ERROR "ocr_accuracy failed (${result}); baseline kept")
+endif()
+
+file(RENAME "${candidate}" "${BASELINE}")
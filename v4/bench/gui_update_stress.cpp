@@ -0,0 +1,224 @@
+// GUI update path under a burst of results, without a display: producer
+// threads push streamed lines and results into the MpscBuffer the RPC
+// threads use, and a 16 ms QTimer applies them to a ResultsModel the way
+// MainWindow::applyUpdates() does (drainForOneTick, then one
+// flushChanges). A stand-in view reads the rows it would repaint. Exits
+// non-zero if any tick took longer than a frame, if the event loop ran a
+// tick more than a frame late (the latency a user would feel), or if
+// results went missing.
+//
+//   ./gui_update_stress
+//   ./gui_update_stress --results 200000 --partials 4 --producers 8
+//
+// options:
+//   --results N        results to push (default 50000)
+//   --partials N       streamed lines before each result (default 2)
+//   --producers N      pushing threads (default 4)
+//   --max-tick-ms N    longest tick allowed (default 16, one frame)
+//   --max-late-ms N    latest a tick may start after it was due
+//                      (default 16, one frame)
+
+#include "OcrUpdate.h"
+#include "ResultsModel.h"
+#include "ThumbnailLoader.h"
+
+#include <QCoreApplication>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// ~60 Hz, as MainWindow's update timer
+constexpr int kTickMs = 16;
+
+// rows a results view shows at once
+constexpr int kVisibleRows = 40;
+
+// the whole run, pushes included; a stuck consumer fails rather than hangs
+constexpr int kTimeoutMs = 120000;
+
+struct StressOptions {
+    int results = 50000;
+    int partials = 2;
+    int producers = 4;
+    double maxTickMs = kTickMs;
+    double maxLateMs = kTickMs;
+};
+
+bool parseArgs(int argc, char** argv, StressOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (arg == "--results" && value) {
+            opt.results = std::max(1, std::atoi(value)); i++;
+        } else if (arg == "--partials" && value) {
+            opt.partials = std::max(0, std::atoi(value)); i++;
+        } else if (arg == "--producers" && value) {
+            opt.producers = std::max(1, std::atoi(value)); i++;
+        } else if (arg == "--max-tick-ms" && value) {
+            opt.maxTickMs = std::atof(value); i++;
+        } else if (arg == "--max-late-ms" && value) {
+            opt.maxLateMs = std::atof(value); i++;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+double msSince(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - since).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+
+    StressOptions opt;
+    if (!parseArgs(argc, argv, opt)) {
+        std::cerr << "usage: gui_update_stress [--results N] [--partials N]"
+                     " [--producers N] [--max-tick-ms N] [--max-late-ms N]" << std::endl;
+        return 2;
+    }
+
+    ThumbnailLoader thumbnails(QSize(64, 64));
+    ResultsModel model(&thumbnails);
+
+    QStringList paths;
+    paths.reserve(opt.results);
+    for (int i = 0; i < opt.results; i++) {
+        paths << QString("/scans/img%1.png").arg(i, 6, 10, QChar('0'));
+    }
+    model.addFiles(1, paths);
+
+    // what a view does with dataChanged: read back the rows it shows
+    long long rowsRead = 0;
+    QObject::connect(&model, &QAbstractItemModel::dataChanged,
+                     [&](const QModelIndex& first, const QModelIndex& last) {
+        int end = std::min(last.row(), first.row() + kVisibleRows - 1);
+        for (int row = first.row(); row <= end; row++) {
+            rowsRead += model.data(model.index(row), Qt::DisplayRole).toString().size() > 0;
+        }
+    });
+
+    MpscBuffer<OcrUpdate> updates;
+    std::atomic<bool> started{false};
+
+    // every producer pushes its share of images as fast as it can, so
+    // the whole batch lands within a few frames
+    std::vector<std::thread> producers;
+    for (int p = 0; p < opt.producers; p++) {
+        producers.emplace_back([&, p]() {
+            while (!started.load()) std::this_thread::yield();
+
+            for (int index = p; index < opt.results; index += opt.producers) {
+                for (int line = 0; line < opt.partials; line++) {
+                    OcrUpdate partial;
+                    partial.partial = true;
+                    partial.batchId = 1;
+                    partial.index = index;
+                    partial.text = QString("line %1 of image %2, as it was streamed").arg(line).arg(index);
+                    updates.push(std::move(partial));
+                }
+
+                OcrUpdate result;
+                result.batchId = 1;
+                result.index = index;
+                result.filename = QString("img%1.png").arg(index);
+                result.success = index % 50 != 0;
+                result.text = QString("Recognized text of image %1, a few lines long,\n"
+                                      "about what a label or receipt comes back as.").arg(index);
+                result.error = result.success ? QString() : QString("Invalid image");
+                result.ms = 40;
+                updates.push(std::move(result));
+            }
+        });
+    }
+
+    int applied = 0;
+    long long updatesApplied = 0;
+    int ticks = 0;
+    std::vector<double> tickMs;
+    double maxLateMs = 0;
+    auto lastTick = std::chrono::steady_clock::now();
+    const auto start = std::chrono::steady_clock::now();
+    bool timedOut = false;
+
+    // precise, so lateness is the event loop's and not the timer's slack
+    QTimer timer;
+    timer.setTimerType(Qt::PreciseTimer);
+    timer.setInterval(kTickMs);
+    QObject::connect(&timer, &QTimer::timeout, [&]() {
+        const auto tickStart = std::chrono::steady_clock::now();
+        maxLateMs = std::max(maxLateMs,
+            std::chrono::duration<double, std::milli>(tickStart - lastTick).count() - kTickMs);
+        lastTick = tickStart;
+
+        // as MainWindow::applyUpdates
+        updatesApplied += drainForOneTick(updates, [&](OcrUpdate&& u) {
+            if (u.partial) {
+                model.appendPartial(u.index, u.text);
+                return;
+            }
+            applied++;
+            model.setResult(u.index, u.success ? u.text : "Error: " + u.error);
+        });
+        model.flushChanges();
+
+        tickMs.push_back(msSince(tickStart));
+        ticks++;
+
+        if (applied == opt.results) app.quit();
+    });
+
+    QTimer::singleShot(kTimeoutMs, [&]() {
+        timedOut = true;
+        app.quit();
+    });
+
+    timer.start();
+    started = true;
+    app.exec();
+
+    for (auto& t : producers) t.join();
+
+    std::sort(tickMs.begin(), tickMs.end());
+    const double maxTick = tickMs.empty() ? 0 : tickMs.back();
+    const double p99Tick = tickMs.empty() ? 0
+        : tickMs[std::min(tickMs.size() - 1, static_cast<size_t>(0.99 * tickMs.size()))];
+
+    std::cout << "[GuiStress] " << applied << "/" << opt.results << " results + "
+              << (updatesApplied - applied) << " lines in " << ticks << " ticks, "
+              << msSince(start) / 1000 << " s"
+              << " | Tick p99 " << p99Tick << " ms, max " << maxTick << " ms"
+              << " | Max timer lateness " << maxLateMs << " ms"
+              << " | Rows read " << rowsRead << std::endl;
+
+    if (timedOut || applied != opt.results) {
+        std::cout << "[GuiStress] FAIL: not every result was applied" << std::endl;
+        return 1;
+    }
+    if (maxTick > opt.maxTickMs) {
+        std::cout << "[GuiStress] FAIL: a tick took " << maxTick << " ms (limit "
+                  << opt.maxTickMs << " ms)" << std::endl;
+        return 1;
+    }
+    if (maxLateMs > opt.maxLateMs) {
+        std::cout << "[GuiStress] FAIL: a tick ran " << maxLateMs << " ms late (limit "
+                  << opt.maxLateMs << " ms)" << std::endl;
+        return 1;
+    }
+    std::cout << "[GuiStress] OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,531 @@
+// Accuracy + throughput regression check over a labeled corpus: every image
+// is recognized once (in-process, or through a running server), scored
+// against its expected text, and the run fails when accuracy or speed is
+// past a limit, so a faster profile or preprocessing step can't quietly
+// cost recognition quality.
+//
+//   ./ocr_accuracy                          dataset/labels.csv, in-process
+//   ./ocr_accuracy --profile line -j 4
+//   ./ocr_accuracy --server localhost:50051
+//   ./ocr_accuracy --json run.json          keep this run as a baseline
+//   ./ocr_accuracy --baseline run.json      fail if worse than that run
+//
+// options:
+//   --labels FILE        labels file (default: dataset/labels.csv)
+//   --server host:port   recognize through a server instead of in-process;
+//                        start it without --result-cache-mb, or reruns are
+//                        answered from its cache
+//   --profile NAME       default, block, line, word, sparse
+//   -j N                 images in flight at once (default: 1, so latency
+//                        is one engine's; raise it for throughput)
+//   --ignore-case        score case-insensitively
+//   --max-cer X          fail above this character error rate (default 0.05)
+//   --max-wer X          fail above this word error rate (default 0.10)
+//   --min-throughput N   fail below N images/s (default: no limit)
+//   --max-p95-ms N       fail above this p95 latency (default: no limit)
+//   --baseline FILE      also fail if CER / WER rose by more than 0.005 /
+//                        0.02, throughput fell by more than 10% or p95
+//                        latency rose by more than 20% against FILE
+//   --json FILE          write the run's summary, usable as a baseline
+//   --show-errors N      print the N worst images (default: 10)
+//
+// Labels file: CSV with the image path (relative to the labels file) and
+// its expected text. A first line starting with "image," is a header.
+// Fields may be double-quoted, with "" for a quote, so text can hold
+// commas and line breaks (scored like spaces):
+//
+//   image,word
+//   img0001.png,irreclaimability
+//   scan01.png,"Dear Sir, ..."
+//
+// Error rates are edit distances over the whole corpus: characters (UTF-8
+// code points) for CER, whitespace-separated words for WER, each divided by
+// the reference length. Whitespace runs count as one space. Exit status is
+// 0 within limits, 1 past one, 2 on a setup error.
+//
+// OCR_DATASET_DIR (env) overrides the dataset/ folder baked in at build time.
+
+#include "OcrEngine.h"
+#include "OcrProfiles.h"
+#include "OcrRpcClient.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// allowed drift against --baseline
+constexpr double kBaselineCerSlack = 0.005;
+constexpr double kBaselineWerSlack = 0.02;
+constexpr double kBaselineThroughputSlack = 0.10;
+constexpr double kBaselineLatencySlack = 0.20;
+
+struct Options {
+    std::string labels;
+    std::string server;         // empty = in-process
+    std::string profile = "default";
+    int concurrency = 1;
+    bool ignoreCase = false;
+    double maxCer = 0.05;
+    double maxWer = 0.10;
+    double minThroughput = 0;
+    double maxP95Ms = 0;
+    std::string baseline;
+    std::string json;
+    int showErrors = 10;
+};
+
+struct Sample {
+    std::string path;
+    std::string expected;
+    std::string image;
+
+    std::string text;
+    bool ok = false;
+    long long latencyUs = 0;
+    size_t charErrors = 0;
+    size_t wordErrors = 0;
+};
+
+struct Summary {
+    size_t images = 0;
+    size_t failed = 0;          // no text came back at all
+    double cer = 0;
+    double wer = 0;
+    double exact = 0;           // fraction of images read exactly right
+    double throughput = 0;      // images/s
+    double p50Ms = 0;
+    double p95Ms = 0;
+    double p99Ms = 0;
+    double maxMs = 0;
+};
+
+std::string datasetDir() {
+    const char* env = std::getenv("OCR_DATASET_DIR");
+    return (env && *env) ? env : OCR_DATASET_DIR;
+}
+
+// one CSV record; false at end of input
+bool readCsvRecord(std::istream& in, std::vector<std::string>& fields) {
+    fields.clear();
+    std::string field;
+    bool quoted = false;
+    bool any = false;
+    char c;
+    while (in.get(c)) {
+        any = true;
+        if (quoted) {
+            if (c == '"') {
+                if (in.peek() == '"') { field += '"'; in.get(); }
+                else quoted = false;
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(std::move(field));
+            field.clear();
+        } else if (c == '\n') {
+            break;
+        } else if (c != '\r') {
+            field += c;
+        }
+    }
+    if (!any) return false;
+    fields.push_back(std::move(field));
+    return true;
+}
+
+bool loadLabels(const std::string& file, std::vector<Sample>& out, std::string& error) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + file;
+        return false;
+    }
+    const fs::path dir = fs::path(file).parent_path();
+
+    std::vector<std::string> fields;
+    bool first = true;
+    while (readCsvRecord(in, fields)) {
+        const bool header = first && fields[0] == "image";
+        first = false;
+        if (header || (fields.size() == 1 && fields[0].empty())) continue;
+        if (fields.size() < 2) {
+            error = "expected image,text in " + file + ": " + fields[0];
+            return false;
+        }
+
+        Sample s;
+        s.path = (dir / fields[0]).string();
+        s.expected = fields[1];
+
+        std::ifstream img(s.path, std::ios::binary);
+        if (!img) {
+            error = "cannot read " + s.path;
+            return false;
+        }
+        std::ostringstream bytes;
+        bytes << img.rdbuf();
+        s.image = bytes.str();
+        out.push_back(std::move(s));
+    }
+    if (out.empty()) error = "no labels in " + file;
+    return !out.empty();
+}
+
+// whitespace runs become one space, none at the ends
+std::string normalize(const std::string& s, bool ignoreCase) {
+    std::string out;
+    bool space = false;
+    for (unsigned char c : s) {
+        if (std::isspace(c)) {
+            space = !out.empty();
+            continue;
+        }
+        if (space) out += ' ';
+        space = false;
+        out += static_cast<char>(ignoreCase ? std::tolower(c) : c);
+    }
+    return out;
+}
+
+// UTF-8 code points; a stray byte counts as one
+std::vector<uint32_t> codePoints(const std::string& s) {
+    std::vector<uint32_t> out;
+    for (size_t i = 0; i < s.size();) {
+        const unsigned char c = s[i];
+        const int len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3
+                      : (c >> 3) == 0x1E ? 4 : 1;
+        uint32_t cp = len == 1 ? c : c & (0x3F >> (len - 1));
+        for (int k = 1; k < len && i + k < s.size(); k++) {
+            cp = (cp << 6) | (static_cast<unsigned char>(s[i + k]) & 0x3F);
+        }
+        out.push_back(cp);
+        i += len;
+    }
+    return out;
+}
+
+std::vector<std::string> words(const std::string& normalized) {
+    std::vector<std::string> out;
+    std::istringstream ss(normalized);
+    std::string w;
+    while (ss >> w) out.push_back(w);
+    return out;
+}
+
+// Levenshtein distance, two rows
+template <typename T>
+size_t editDistance(const std::vector<T>& a, const std::vector<T>& b) {
+    std::vector<size_t> prev(b.size() + 1), cur(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); j++) prev[j] = j;
+
+    for (size_t i = 1; i <= a.size(); i++) {
+        cur[0] = i;
+        for (size_t j = 1; j <= b.size(); j++) {
+            const size_t sub = prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+            cur[j] = std::min({prev[j] + 1, cur[j - 1] + 1, sub});
+        }
+        std::swap(prev, cur);
+    }
+    return prev[b.size()];
+}
+
+// Recognizes every sample, -j at a time. In-process, each thread has
+// its own engine, created (and its models loaded) before the clock starts.
+bool runAll(const Options& opt, std::vector<Sample>& samples, double& wallSecs,
+            std::string& error) {
+    EngineConfig cfg;
+    if (!profileConfig(opt.profile, cfg)) {
+        error = "unknown profile: " + opt.profile;
+        return false;
+    }
+
+    std::vector<std::unique_ptr<OcrEngine>> engines;
+    std::unique_ptr<OcrRpcClient> client;
+    if (opt.server.empty()) {
+        for (int t = 0; t < opt.concurrency; t++) {
+            engines.push_back(std::make_unique<OcrEngine>(cfg, resolveTessdataDir()));
+            if (!engines.back()->initialized()) {
+                error = "Tesseract failed to initialize";
+                return false;
+            }
+        }
+    } else {
+        client = std::make_unique<OcrRpcClient>(opt.server);
+        ocr::OcrOptions options;
+        options.set_profile(opt.profile);
+        client->setOptions(options);
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<int> cached{0};
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opt.concurrency; t++) {
+        threads.emplace_back([&, t] {
+            for (size_t i = next++; i < samples.size(); i = next++) {
+                Sample& s = samples[i];
+                auto begin = std::chrono::steady_clock::now();
+                if (client) {
+                    OcrRpcResult res = client->recognize(1, static_cast<int>(i),
+                                                         s.path, s.image);
+                    s.ok = res.success;
+                    s.text = res.text;
+                    if (res.cacheHit || res.nearDuplicate) cached++;
+                } else {
+                    long long ms = 0;
+                    s.ok = engines[t]->recognize(s.image, s.text, ms);
+                }
+                s.latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - begin).count();
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    wallSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (cached > 0) {
+        std::cerr << "[Accuracy] Warning: " << cached << " results came from the server's"
+                  << " cache; its timings don't measure OCR" << std::endl;
+    }
+    return true;
+}
+
+Summary score(const Options& opt, std::vector<Sample>& samples, double wallSecs) {
+    Summary sum;
+    sum.images = samples.size();
+
+    size_t refChars = 0, refWords = 0, charErrors = 0, wordErrors = 0, exact = 0;
+    std::vector<long long> latencies;
+    for (Sample& s : samples) {
+        const std::string expected = normalize(s.expected, opt.ignoreCase);
+        const std::string got = normalize(s.text, opt.ignoreCase);
+
+        const std::vector<uint32_t> refC = codePoints(expected);
+        const std::vector<std::string> refW = words(expected);
+        s.charErrors = editDistance(refC, codePoints(got));
+        s.wordErrors = editDistance(refW, words(got));
+
+        refChars += refC.size();
+        refWords += refW.size();
+        charErrors += s.charErrors;
+        wordErrors += s.wordErrors;
+        if (expected == got) exact++;
+        if (!s.ok) sum.failed++;
+        latencies.push_back(s.latencyUs);
+    }
+
+    sum.cer = refChars ? static_cast<double>(charErrors) / refChars : 0;
+    sum.wer = refWords ? static_cast<double>(wordErrors) / refWords : 0;
+    sum.exact = static_cast<double>(exact) / samples.size();
+    sum.throughput = wallSecs > 0 ? samples.size() / wallSecs : 0;
+
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) {
+        size_t i = static_cast<size_t>(p * (latencies.size() - 1) + 0.5);
+        return latencies[std::min(i, latencies.size() - 1)] / 1000.0;
+    };
+    sum.p50Ms = pct(0.50);
+    sum.p95Ms = pct(0.95);
+    sum.p99Ms = pct(0.99);
+    sum.maxMs = latencies.back() / 1000.0;
+    return sum;
+}
+
+void writeJson(const std::string& file, const Options& opt, const Summary& s) {
+    std::ofstream out(file);
+    out << "{\n"
+        << "  \"profile\": \"" << opt.profile << "\",\n"
+        << "  \"mode\": \"" << (opt.server.empty() ? "engine" : "server") << "\",\n"
+        << "  \"concurrency\": " << opt.concurrency << ",\n"
+        << "  \"images\": " << s.images << ",\n"
+        << "  \"failed\": " << s.failed << ",\n"
+        << "  \"cer\": " << s.cer << ",\n"
+        << "  \"wer\": " << s.wer << ",\n"
+        << "  \"exact\": " << s.exact << ",\n"
+        << "  \"throughput\": " << s.throughput << ",\n"
+        << "  \"p50_ms\": " << s.p50Ms << ",\n"
+        << "  \"p95_ms\": " << s.p95Ms << ",\n"
+        << "  \"p99_ms\": " << s.p99Ms << ",\n"
+        << "  \"max_ms\": " << s.maxMs << "\n"
+        << "}\n";
+}
+
+// reads back the numbers writeJson wrote
+bool readJson(const std::string& file, Summary& s) {
+    std::ifstream in(file);
+    if (!in) return false;
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string text = ss.str();
+
+    auto number = [&](const char* key, double& out) {
+        const std::string quoted = std::string("\"") + key + "\":";
+        size_t at = text.find(quoted);
+        if (at == std::string::npos) return false;
+        out = std::strtod(text.c_str() + at + quoted.size(), nullptr);
+        return true;
+    };
+    return number("cer", s.cer) && number("wer", s.wer) &&
+           number("throughput", s.throughput) && number("p95_ms", s.p95Ms);
+}
+
+// prints each limit that was passed; true if none
+bool checkLimits(const Options& opt, const Summary& s) {
+    bool ok = true;
+    auto fail = [&](const std::string& what) {
+        std::cerr << "[Accuracy] FAIL: " << what << std::endl;
+        ok = false;
+    };
+
+    if (s.cer > opt.maxCer) fail("CER " + std::to_string(s.cer) + " > " + std::to_string(opt.maxCer));
+    if (s.wer > opt.maxWer) fail("WER " + std::to_string(s.wer) + " > " + std::to_string(opt.maxWer));
+    if (opt.minThroughput > 0 && s.throughput < opt.minThroughput) {
+        fail("throughput " + std::to_string(s.throughput) + " img/s < " +
+             std::to_string(opt.minThroughput));
+    }
+    if (opt.maxP95Ms > 0 && s.p95Ms > opt.maxP95Ms) {
+        fail("p95 " + std::to_string(s.p95Ms) + " ms > " + std::to_string(opt.maxP95Ms));
+    }
+
+    if (!opt.baseline.empty()) {
+        Summary base;
+        if (!readJson(opt.baseline, base)) {
+            fail("cannot read baseline " + opt.baseline);
+            return false;
+        }
+        if (s.cer > base.cer + kBaselineCerSlack) {
+            fail("CER " + std::to_string(s.cer) + " vs baseline " + std::to_string(base.cer));
+        }
+        if (s.wer > base.wer + kBaselineWerSlack) {
+            fail("WER " + std::to_string(s.wer) + " vs baseline " + std::to_string(base.wer));
+        }
+        if (s.throughput < base.throughput * (1 - kBaselineThroughputSlack)) {
+            fail("throughput " + std::to_string(s.throughput) + " img/s vs baseline " +
+                 std::to_string(base.throughput));
+        }
+        if (s.p95Ms > base.p95Ms * (1 + kBaselineLatencySlack)) {
+            fail("p95 " + std::to_string(s.p95Ms) + " ms vs baseline " +
+                 std::to_string(base.p95Ms));
+        }
+    }
+    return ok;
+}
+
+void printUsage() {
+    std::cerr <<
+        "usage: ocr_accuracy [--labels FILE] [--server host:port] [--profile NAME]\n"
+        "                    [-j N] [--ignore-case] [--max-cer X] [--max-wer X]\n"
+        "                    [--min-throughput N] [--max-p95-ms N]\n"
+        "                    [--baseline FILE] [--json FILE] [--show-errors N]\n";
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (arg == "--labels" && value) {
+            opt.labels = value; i++;
+        } else if (arg == "--server" && value) {
+            opt.server = value; i++;
+        } else if (arg == "--profile" && value) {
+            opt.profile = value; i++;
+        } else if (arg == "-j" && value) {
+            opt.concurrency = std::max(1, std::atoi(value)); i++;
+        } else if (arg == "--ignore-case") {
+            opt.ignoreCase = true;
+        } else if (arg == "--max-cer" && value) {
+            opt.maxCer = std::atof(value); i++;
+        } else if (arg == "--max-wer" && value) {
+            opt.maxWer = std::atof(value); i++;
+        } else if (arg == "--min-throughput" && value) {
+            opt.minThroughput = std::atof(value); i++;
+        } else if (arg == "--max-p95-ms" && value) {
+            opt.maxP95Ms = std::atof(value); i++;
+        } else if (arg == "--baseline" && value) {
+            opt.baseline = value; i++;
+        } else if (arg == "--json" && value) {
+            opt.json = value; i++;
+        } else if (arg == "--show-errors" && value) {
+            opt.showErrors = std::max(0, std::atoi(value)); i++;
+        } else {
+            return false;
+        }
+    }
+    if (opt.labels.empty()) opt.labels = datasetDir() + "/labels.csv";
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        printUsage();
+        return 2;
+    }
+
+    std::vector<Sample> samples;
+    std::string error;
+    if (!loadLabels(opt.labels, samples, error)) {
+        std::cerr << "[Accuracy] " << error << std::endl;
+        return 2;
+    }
+
+    double wallSecs = 0;
+    if (!runAll(opt, samples, wallSecs, error)) {
+        std::cerr << "[Accuracy] " << error << std::endl;
+        return 2;
+    }
+    Summary s = score(opt, samples, wallSecs);
+
+    // worst first
+    std::vector<const Sample*> wrong;
+    for (const Sample& sample : samples) {
+        if (sample.charErrors > 0 || !sample.ok) wrong.push_back(&sample);
+    }
+    std::sort(wrong.begin(), wrong.end(), [](const Sample* a, const Sample* b) {
+        return a->charErrors > b->charErrors;
+    });
+    for (size_t i = 0; i < wrong.size() && i < static_cast<size_t>(opt.showErrors); i++) {
+        const Sample& w = *wrong[i];
+        std::cerr << "[Accuracy] " << fs::path(w.path).filename().string()
+                  << ": expected \"" << normalize(w.expected, false)
+                  << "\" got \"" << normalize(w.text, false) << "\""
+                  << (w.ok ? "" : " (failed)") << std::endl;
+    }
+
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "[Accuracy] %zu images (%s, %s, -j %d) | CER %.4f | WER %.4f | exact %.1f%%",
+                  s.images, opt.profile.c_str(), opt.server.empty() ? "engine" : "server",
+                  opt.concurrency, s.cer, s.wer, s.exact * 100);
+    std::cerr << line << std::endl;
+    std::snprintf(line, sizeof(line),
+                  "[Accuracy] %.2f img/s | latency ms p50 %.1f | p95 %.1f | p99 %.1f | max %.1f",
+                  s.throughput, s.p50Ms, s.p95Ms, s.p99Ms, s.maxMs);
+    std::cerr << line << std::endl;
+
+    if (!opt.json.empty()) writeJson(opt.json, opt, s);
+
+    return checkLimits(opt, s) ? 0 : 1;
+}
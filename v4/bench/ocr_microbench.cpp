@@ -0,0 +1,734 @@
+// Microbenchmarks for the server's hot components, each measured in isolation.
+//
+// run all and keep the results for diffing between builds:
+//   ./ocr_microbench --benchmark_out=run.json --benchmark_out_format=json
+//
+// profile throughput on dataset/ only:
+//   ./ocr_microbench --benchmark_filter=BM_RecognizeProfile
+//
+// model tiers / cascade (needs tessdata_fast and tessdata_best checkouts):
+//   export TESSDATA_FAST_DIR=... TESSDATA_BEST_DIR=...
+//   ./ocr_microbench --benchmark_filter='BM_RecognizeTier|BM_Cascade'
+//
+// local transports, TCP loopback vs Unix socket vs shared memory:
+//   ./ocr_microbench --benchmark_filter=BM_LocalTransport
+//
+// allocations per image with and without the per-worker PIX cache:
+//   ./ocr_microbench --benchmark_filter=BM_DecodeRecognizeAllocs
+//
+// small strips one at a time vs stacked on composite pages (--micro-batch-ms):
+//   ./ocr_microbench --benchmark_filter=BM_MicroBatch
+//
+// near-duplicate matching by perceptual hash, per distance threshold:
+//   ./ocr_microbench --benchmark_filter=BM_NearDuplicate
+//
+// OCR_DATASET_DIR (env) overrides the dataset/ folder baked in at build time.
+
+#include <benchmark/benchmark.h>
+
+#include "JobQueue.h"
+#include "MicroBatch.h"
+#include "OcrEngine.h"
+#include "OcrProfiles.h"
+#include "OcrRpcClient.h"
+#include "PerceptualHash.h"
+#include "PixArena.h"
+#include "ShmRing.h"
+#include "WorkerPool.h"
+#include "ocr.pb.h"
+
+#include <grpcpp/grpcpp.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <leptonica/allheaders.h>
+
+// every malloc() in the process, for allocations-per-image counters;
+// glibc only, elsewhere the counter stays at 0
+std::atomic<long long> mallocCalls{0};
+
+#if defined(__GLIBC__)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* malloc(size_t size) {
+    mallocCalls.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+#endif
+
+namespace {
+
+std::string datasetDir() {
+    const char* env = std::getenv("OCR_DATASET_DIR");
+    return (env && *env) ? env : OCR_DATASET_DIR;
+}
+
+// loads dataset/imgNNNN.png; empty string if it is missing
+std::string loadDatasetImage(int n) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/img%04d.png", n);
+
+    std::ifstream in(datasetDir() + name, std::ios::binary);
+    if (!in) return {};
+
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// all of dataset/, loaded once
+const std::vector<std::string>& datasetImages() {
+    static std::vector<std::string> images = [] {
+        std::vector<std::string> all;
+        for (int n = 1; n <= 100; n++) {
+            std::string img = loadDatasetImage(n);
+            if (!img.empty()) all.push_back(std::move(img));
+        }
+        return all;
+    }();
+    return images;
+}
+
+// representative picks from dataset/: first, middle and last strip
+void DatasetImages(benchmark::internal::Benchmark* b) {
+    b->Arg(1)->Arg(50)->Arg(100);
+}
+
+
+void BM_PixReadMem(benchmark::State& state) {
+    std::string img = loadDatasetImage(static_cast<int>(state.range(0)));
+    if (img.empty()) {
+        state.SkipWithError("dataset image not found");
+        return;
+    }
+
+    for (auto _ : state) {
+        PIX* pix = pixReadMem((l_uint8*)img.data(), img.size());
+        benchmark::DoNotOptimize(pix);
+        pixDestroy(&pix);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(img.size()));
+}
+BENCHMARK(BM_PixReadMem)->Apply(DatasetImages);
+
+
+void BM_OcrEngineRecognize(benchmark::State& state) {
+    static OcrEngine engine;
+    if (!engine.initialized()) {
+        state.SkipWithError("Tesseract failed to initialize");
+        return;
+    }
+
+    std::string img = loadDatasetImage(static_cast<int>(state.range(0)));
+    if (img.empty()) {
+        state.SkipWithError("dataset image not found");
+        return;
+    }
+
+    std::string text;
+    long long ms = 0;
+    for (auto _ : state) {
+        bool ok = engine.recognize(img, text, ms);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OcrEngineRecognize)->Apply(DatasetImages)->Unit(benchmark::kMillisecond);
+
+
+// A worker's decode + recognize, as processJob does it, over all of
+// dataset/; arg 1 keeps freed PIX buffers on the thread (--pix-cache-mb)
+void BM_DecodeRecognizeAllocs(benchmark::State& state) {
+    static OcrEngine engine;
+    const std::vector<std::string>& images = datasetImages();
+    if (!engine.initialized() || images.empty()) {
+        state.SkipWithError("Tesseract or dataset not available");
+        return;
+    }
+
+    PixArena::enableThreadCache(state.range(0) ? (32 << 20) : 0);
+
+    std::string text;
+    long long ms = 0;
+    long long mallocs = 0;
+    long long pixMallocs = 0;
+    size_t i = 0;
+    for (auto _ : state) {
+        const std::string& img = images[i++ % images.size()];
+        long long mallocStart = mallocCalls.load(std::memory_order_relaxed);
+        long long pixStart = PixArena::stats().systemAllocations;
+
+        PIX* pix = pixReadMem((l_uint8*)img.data(), img.size());
+        engine.recognize(pix, text, ms);
+        pixDestroy(&pix);
+
+        mallocs += mallocCalls.load(std::memory_order_relaxed) - mallocStart;
+        pixMallocs += PixArena::stats().systemAllocations - pixStart;
+    }
+    PixArena::enableThreadCache(0);
+
+    const double n = state.iterations() > 0 ? static_cast<double>(state.iterations()) : 1.0;
+    state.SetItemsProcessed(state.iterations());
+    state.counters["mallocs_per_image"] = mallocs / n;
+    state.counters["pix_mallocs_per_image"] = pixMallocs / n;
+}
+BENCHMARK(BM_DecodeRecognizeAllocs)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+
+// whole dataset/ once per iteration, with the engine configured by a profile;
+// items_per_second is the throughput to compare between profiles
+void BM_RecognizeProfile(benchmark::State& state, const char* profile) {
+    const std::vector<std::string>& images = datasetImages();
+    if (images.empty()) {
+        state.SkipWithError("dataset images not found");
+        return;
+    }
+
+    EngineConfig cfg;
+    profileConfig(profile, cfg);
+    OcrEngine engine(cfg, resolveTessdataDir());
+    if (!engine.initialized()) {
+        state.SkipWithError("Tesseract failed to initialize");
+        return;
+    }
+
+    std::string text;
+    long long ms = 0;
+    for (auto _ : state) {
+        for (const std::string& img : images) {
+            bool ok = engine.recognize(img, text, ms);
+            benchmark::DoNotOptimize(ok);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(images.size()));
+}
+BENCHMARK_CAPTURE(BM_RecognizeProfile, default, "default")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_RecognizeProfile, block, "block")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_RecognizeProfile, line, "line")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_RecognizeProfile, word, "word")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_RecognizeProfile, sparse, "sparse")->Unit(benchmark::kMillisecond);
+
+
+// model tiers need their own folders: TESSDATA_FAST_DIR / TESSDATA_BEST_DIR
+std::string tierDir(ModelTier tier) {
+    const char* env = nullptr;
+    if (tier == ModelTier::Fast) env = std::getenv("TESSDATA_FAST_DIR");
+    if (tier == ModelTier::Best) env = std::getenv("TESSDATA_BEST_DIR");
+    if (tier == ModelTier::Standard) return resolveTessdataDir();
+    return (env && *env) ? env : "";
+}
+
+// dataset/ strips use the "line" profile, like production traffic would
+EngineConfig tierConfig(ModelTier tier) {
+    EngineConfig cfg;
+    profileConfig("line", cfg);
+    cfg.tier = tier;
+    return cfg;
+}
+
+// trailing newlines differ between tiers and don't matter for agreement
+std::string normalized(std::string s) {
+    while (!s.empty() && (s.back() == '\n' || s.back() == ' ')) s.pop_back();
+    return s;
+}
+
+// all of dataset/ on one tier
+void BM_RecognizeTier(benchmark::State& state, ModelTier tier) {
+    const std::vector<std::string>& images = datasetImages();
+    std::string dir = tierDir(tier);
+    if (images.empty() || dir.empty()) {
+        state.SkipWithError("dataset or tier models not found");
+        return;
+    }
+
+    OcrEngine engine(tierConfig(tier), dir);
+    if (!engine.initialized()) {
+        state.SkipWithError("Tesseract failed to initialize");
+        return;
+    }
+
+    std::string text;
+    long long ms = 0;
+    for (auto _ : state) {
+        for (const std::string& img : images) {
+            benchmark::DoNotOptimize(engine.recognize(img, text, ms));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(images.size()));
+}
+BENCHMARK_CAPTURE(BM_RecognizeTier, fast, ModelTier::Fast)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_RecognizeTier, best, ModelTier::Best)->Unit(benchmark::kMillisecond);
+
+// fast tier first, best tier only below the confidence threshold (the arg).
+// agreement = share of images whose text equals the always-best baseline
+void BM_Cascade(benchmark::State& state) {
+    const std::vector<std::string>& images = datasetImages();
+    std::string fastDir = tierDir(ModelTier::Fast);
+    std::string bestDir = tierDir(ModelTier::Best);
+    if (images.empty() || fastDir.empty() || bestDir.empty()) {
+        state.SkipWithError("dataset or tier models not found");
+        return;
+    }
+
+    OcrEngine fast(tierConfig(ModelTier::Fast), fastDir);
+    OcrEngine best(tierConfig(ModelTier::Best), bestDir);
+    if (!fast.initialized() || !best.initialized()) {
+        state.SkipWithError("Tesseract failed to initialize");
+        return;
+    }
+
+    std::vector<std::string> baseline;
+    std::string text;
+    long long ms = 0;
+    for (const std::string& img : images) {
+        best.recognize(img, text, ms);
+        baseline.push_back(normalized(text));
+    }
+
+    const int threshold = static_cast<int>(state.range(0));
+    int escalated = 0;
+    int agreed = 0;
+    for (auto _ : state) {
+        escalated = 0;
+        agreed = 0;
+        for (size_t i = 0; i < images.size(); i++) {
+            bool ok = fast.recognize(images[i], text, ms);
+            if (!ok || fast.lastConfidence() < threshold) {
+                best.recognize(images[i], text, ms);
+                escalated++;
+            }
+            if (normalized(text) == baseline[i]) agreed++;
+        }
+    }
+
+    const double n = static_cast<double>(images.size());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(images.size()));
+    state.counters["escalation_rate"] = escalated / n;
+    state.counters["agreement"] = agreed / n;
+}
+BENCHMARK(BM_Cascade)->Arg(60)->Arg(70)->Arg(80)->Arg(90)->Unit(benchmark::kMillisecond);
+
+
+// every thread pushes then pops, so all of them fight over the same lock
+void BM_JobQueuePushPop(benchmark::State& state) {
+    static JobQueue queue;
+
+    for (auto _ : state) {
+        OcrJob job;
+        job.index = state.thread_index();
+        queue.push(std::move(job));
+
+        auto popped = queue.pop();
+        benchmark::DoNotOptimize(popped);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_JobQueuePushPop)->ThreadRange(1, 16)->UseRealTime();
+
+
+// image payloads from a small strip up to a multi-MB scan
+void PayloadSizes(benchmark::internal::Benchmark* b) {
+    b->RangeMultiplier(8)->Range(1 << 10, 8 << 20);
+}
+
+ocr::OcrRequest makeRequest(size_t bytes) {
+    ocr::OcrRequest req;
+    req.set_batch_id(1);
+    req.set_image_index(42);
+    req.set_filename("img0042.png");
+    req.set_image_data(std::string(bytes, '\x5a'));
+    return req;
+}
+
+ocr::OcrResponse makeResponse(size_t bytes) {
+    ocr::OcrResponse res;
+    res.set_batch_id(1);
+    res.set_image_index(42);
+    res.set_filename("img0042.png");
+    res.set_text(std::string(bytes, 'a'));
+    res.set_success(true);
+    res.set_processing_time_ms(123);
+    return res;
+}
+
+void BM_OcrRequestSerialize(benchmark::State& state) {
+    ocr::OcrRequest req = makeRequest(state.range(0));
+    std::string wire;
+    for (auto _ : state) {
+        req.SerializeToString(&wire);
+        benchmark::DoNotOptimize(wire.data());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OcrRequestSerialize)->Apply(PayloadSizes);
+
+void BM_OcrRequestParse(benchmark::State& state) {
+    std::string wire = makeRequest(state.range(0)).SerializeAsString();
+    ocr::OcrRequest req;
+    for (auto _ : state) {
+        bool ok = req.ParseFromString(wire);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OcrRequestParse)->Apply(PayloadSizes);
+
+// recognized text is much smaller than the image, so sizes stop at 64 KB
+void BM_OcrResponseSerialize(benchmark::State& state) {
+    ocr::OcrResponse res = makeResponse(state.range(0));
+    std::string wire;
+    for (auto _ : state) {
+        res.SerializeToString(&wire);
+        benchmark::DoNotOptimize(wire.data());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OcrResponseSerialize)->RangeMultiplier(8)->Range(16, 64 << 10);
+
+void BM_OcrResponseParse(benchmark::State& state) {
+    std::string wire = makeResponse(state.range(0)).SerializeAsString();
+    ocr::OcrResponse res;
+    for (auto _ : state) {
+        bool ok = res.ParseFromString(wire);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OcrResponseParse)->RangeMultiplier(8)->Range(16, 64 << 10);
+
+
+// pool whose workers do nothing, so only queueing + wakeup + promise remain
+WorkerPool::HandlerFactory noopEngine() {
+    return [](int) {
+        return [](OcrJob&) {
+            OcrResult result;
+            result.success = true;
+            return result;
+        };
+    };
+}
+
+// one job in flight: round-trip latency of a dispatch
+void BM_WorkerPoolDispatch(benchmark::State& state) {
+    WorkerPool pool(static_cast<int>(state.range(0)), noopEngine());
+
+    for (auto _ : state) {
+        OcrJob job;
+        job.done = std::make_shared<std::promise<OcrResult>>();
+        auto pending = job.done->get_future();
+        pool.pushJob(std::move(job));
+        benchmark::DoNotOptimize(pending.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_WorkerPoolDispatch)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+
+// a burst of jobs: dispatch throughput with all workers busy
+void BM_WorkerPoolBurst(benchmark::State& state) {
+    constexpr int kBurst = 256;
+    WorkerPool pool(static_cast<int>(state.range(0)), noopEngine());
+
+    std::vector<std::future<OcrResult>> pending;
+    pending.reserve(kBurst);
+
+    for (auto _ : state) {
+        pending.clear();
+        for (int i = 0; i < kBurst; i++) {
+            OcrJob job;
+            job.index = i;
+            job.done = std::make_shared<std::promise<OcrResult>>();
+            pending.push_back(job.done->get_future());
+            pool.pushJob(std::move(job));
+        }
+        for (auto& f : pending) f.wait();
+    }
+    state.SetItemsProcessed(state.iterations() * kBurst);
+}
+BENCHMARK(BM_WorkerPoolBurst)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+
+
+// ---------- local transport ----------
+
+// Stands in for the OCR server: takes the image bytes the same way (inline
+// or from a shared-memory slot) and reads every byte, as the decoder would,
+// so only moving the bytes differs between transports.
+class TransportService final : public ocr::OcrService::Service {
+public:
+    grpc::Status RecognizeImage(grpc::ServerContext*, const ocr::OcrRequest* req,
+                                ocr::OcrResponse* res) override {
+        std::string_view bytes = req->image_data();
+        std::shared_ptr<const ShmMapping> mapping;
+
+        if (req->has_shm_slot()) {
+            ShmSlotHandle handle;
+            handle.segment = req->shm_slot().segment();
+            handle.slot = req->shm_slot().slot();
+            handle.generation = req->shm_slot().generation();
+            handle.length = req->shm_slot().length();
+
+            std::string error;
+            mapping = segments_.get(handle.segment, error);
+            if (!mapping || !mapping->view(handle, bytes, error)) {
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error);
+            }
+        }
+
+        unsigned sum = 0;
+        for (unsigned char c : bytes) sum += c;
+        res->set_text(std::to_string(sum));
+        res->set_success(true);
+        return grpc::Status::OK;
+    }
+
+private:
+    ShmMappingCache segments_;
+};
+
+// one in-process server on both a loopback port and a Unix socket
+struct TransportServer {
+    TransportService service;
+    std::unique_ptr<grpc::Server> server;
+    std::string tcpAddress;
+    std::string unixAddress;
+
+    TransportServer() {
+        std::string socketPath = "/tmp/ocr-bench-" + std::to_string(getpid()) + ".sock";
+        unlink(socketPath.c_str());
+
+        int port = 0;
+        grpc::ServerBuilder builder;
+        builder.SetMaxReceiveMessageSize(64 << 20);
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.AddListeningPort("unix:" + socketPath, grpc::InsecureServerCredentials());
+        builder.RegisterService(&service);
+        server = builder.BuildAndStart();
+
+        tcpAddress = "127.0.0.1:" + std::to_string(port);
+        unixAddress = "unix:" + socketPath;
+    }
+};
+
+TransportServer& transportServer() {
+    static TransportServer server;
+    return server;
+}
+
+enum class Transport { Tcp, Unix, UnixShm };
+
+double processCpuSeconds() {
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+           (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// Client and server share this process, so process CPU time covers both
+// ends: cpu_us_per_image is the whole cost of getting one image across.
+void BM_LocalTransport(benchmark::State& state, Transport transport) {
+    TransportServer& server = transportServer();
+    const size_t bytes = static_cast<size_t>(state.range(0));
+
+    OcrRpcClient client(transport == Transport::Tcp ? server.tcpAddress
+                                                    : server.unixAddress);
+    if (transport == Transport::UnixShm) {
+        std::string error;
+        if (!client.enableSharedMemory(1, bytes, error)) {
+            state.SkipWithError(error.c_str());
+            return;
+        }
+    }
+
+    std::string image(bytes, '\x5a');
+    std::string data;
+
+    // connect before timing
+    client.recognize(1, 0, "warmup.png", image);
+
+    double cpuStart = processCpuSeconds();
+    for (auto _ : state) {
+        data = image;   // the client owns the bytes it sends, as after a file read
+        OcrRpcResult result = client.recognize(1, 0, "img.png", std::move(data));
+        if (!result.success) {
+            state.SkipWithError(result.error.c_str());
+            break;
+        }
+    }
+    double cpu = processCpuSeconds() - cpuStart;
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["cpu_us_per_image"] = state.iterations() > 0
+        ? cpu * 1e6 / state.iterations() : 0.0;
+}
+BENCHMARK_CAPTURE(BM_LocalTransport, tcp, Transport::Tcp)
+    ->RangeMultiplier(4)->Range(256 << 10, 16 << 20)->UseRealTime();
+BENCHMARK_CAPTURE(BM_LocalTransport, unix, Transport::Unix)
+    ->RangeMultiplier(4)->Range(256 << 10, 16 << 20)->UseRealTime();
+BENCHMARK_CAPTURE(BM_LocalTransport, unix_shm, Transport::UnixShm)
+    ->RangeMultiplier(4)->Range(256 << 10, 16 << 20)->UseRealTime();
+
+
+// All of dataset/, arg images per Tesseract call: 1 = one at a time as the
+// server does by default, more = stacked on a composite page and split
+// back by text line. agreement = share of images whose text matches the
+// one-at-a-time run.
+void BM_MicroBatch(benchmark::State& state) {
+    const std::vector<std::string>& images = datasetImages();
+    EngineConfig blockCfg;
+    blockCfg.psm = tesseract::PSM_SINGLE_BLOCK;
+    static OcrEngine single;
+    static OcrEngine block(blockCfg, resolveTessdataDir());
+    if (images.empty() || !single.initialized() || !block.initialized()) {
+        state.SkipWithError("Tesseract or dataset not available");
+        return;
+    }
+
+    std::vector<PIX*> pixes;
+    for (const std::string& img : images) {
+        if (PIX* pix = pixReadMem((l_uint8*)img.data(), img.size())) pixes.push_back(pix);
+    }
+
+    std::vector<std::string> baseline;
+    std::string text;
+    long long ms = 0;
+    for (PIX* pix : pixes) {
+        single.recognize(pix, text, ms);
+        baseline.push_back(normalized(text));
+    }
+
+    const size_t batch = static_cast<size_t>(state.range(0));
+    std::vector<std::string> out(pixes.size());
+    for (auto _ : state) {
+        for (size_t first = 0; first < pixes.size(); first += batch) {
+            const size_t n = std::min(batch, pixes.size() - first);
+            if (n == 1) {
+                single.recognize(pixes[first], out[first], ms);
+                continue;
+            }
+
+            std::vector<PIX*> strips(pixes.begin() + first, pixes.begin() + first + n);
+            CompositePage page;
+            std::vector<TextSegment> lines;
+            std::vector<std::string> texts;
+            std::vector<int> confidences;
+            if (page.build(strips) &&
+                block.recognizeSegments(page.pix(), nullptr, tesseract::RIL_TEXTLINE, lines, text)) {
+                page.split(lines, texts, confidences);
+                for (size_t k = 0; k < n; k++) out[first + k] = std::move(texts[k]);
+            }
+        }
+    }
+
+    int agreed = 0;
+    for (size_t i = 0; i < pixes.size(); i++) {
+        if (normalized(out[i]) == baseline[i]) agreed++;
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(pixes.size()));
+    state.counters["agreement"] = pixes.empty() ? 0.0 : static_cast<double>(agreed) / pixes.size();
+
+    for (PIX*& pix : pixes) pixDestroy(&pix);
+}
+BENCHMARK(BM_MicroBatch)->Arg(1)->Arg(4)->Arg(8)->Arg(16)->Unit(benchmark::kMillisecond);
+
+
+// re-encoded copy of a page, as a re-scan or a forwarded JPEG would be
+PIX* degradedCopy(PIX* pix, float scale, int jpegQuality) {
+    PIX* scaled = scale != 1.0f ? pixScale(pix, scale, scale) : pixClone(pix);
+    PIX* gray = pixConvertTo8(scaled, 0);
+    pixDestroy(&scaled);
+
+    l_uint8* jpeg = nullptr;
+    size_t size = 0;
+    pixWriteMemJpeg(&jpeg, &size, gray, jpegQuality, 0);
+    pixDestroy(&gray);
+
+    PIX* out = jpeg ? pixReadMem(jpeg, size) : nullptr;
+    lept_free(jpeg);
+    return out;
+}
+
+// Times hashing a decoded image and reports, at the threshold (the arg):
+//   hit_rate          degraded copies matched to their own original
+//   false_match_rate  pairs of different dataset images that would match
+void BM_NearDuplicate(benchmark::State& state) {
+    const std::vector<std::string>& images = datasetImages();
+    if (images.empty()) {
+        state.SkipWithError("dataset not found");
+        return;
+    }
+
+    std::vector<PIX*> pixes;
+    std::vector<PerceptualHash> originals;
+    std::vector<std::pair<size_t, PerceptualHash>> copies;
+    for (const std::string& img : images) {
+        PIX* pix = pixReadMem((l_uint8*)img.data(), img.size());
+        PerceptualHash h;
+        if (!pix || !perceptualHash(pix, h)) {
+            pixDestroy(&pix);
+            continue;
+        }
+        const size_t id = originals.size();
+        pixes.push_back(pix);
+        originals.push_back(h);
+
+        const struct { float scale; int quality; } variants[] = {
+            {1.0f, 50}, {0.9f, 75}, {0.9f, 30},
+        };
+        for (const auto& v : variants) {
+            PIX* copy = degradedCopy(pix, v.scale, v.quality);
+            if (copy && perceptualHash(copy, h)) copies.emplace_back(id, h);
+            pixDestroy(&copy);
+        }
+    }
+
+    size_t i = 0;
+    PerceptualHash h;
+    for (auto _ : state) {
+        bool ok = perceptualHash(pixes[i++ % pixes.size()], h);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    const int threshold = static_cast<int>(state.range(0));
+    int hits = 0;
+    for (const auto& [id, copy] : copies) {
+        if (copy.distance(originals[id]) <= threshold) hits++;
+    }
+    int falseMatches = 0;
+    int pairs = 0;
+    for (size_t a = 0; a < originals.size(); a++) {
+        for (size_t b = a + 1; b < originals.size(); b++) {
+            pairs++;
+            if (originals[a].distance(originals[b]) <= threshold &&
+                originals[a].similarShape(originals[b])) {
+                falseMatches++;
+            }
+        }
+    }
+    state.counters["hit_rate"] = copies.empty() ? 0.0 : static_cast<double>(hits) / copies.size();
+    state.counters["false_match_rate"] = pairs ? static_cast<double>(falseMatches) / pairs : 0.0;
+
+    for (PIX*& pix : pixes) pixDestroy(&pix);
+}
+BENCHMARK(BM_NearDuplicate)->DenseRange(8, 40, 8)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // as in the server, before the first PIX exists
+    PixArena::install();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
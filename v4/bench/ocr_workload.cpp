@@ -0,0 +1,724 @@
+// Synthetic workload generator: renders text images with known ground truth,
+// at any count, for scale tests the 100 images in dataset/ can't drive
+// (queue growth, cache eviction, memory under big batches, mixed sizes).
+// The same seed and options always give the same images, names and
+// order, on any machine.
+//
+//   ./ocr_workload --count 100000 --out /tmp/load
+//   ./ocr_cli -j 32 - < /tmp/load/paths.txt            replay, in order
+//   ./ocr_accuracy --labels /tmp/load/labels.csv       score a sample
+//
+//   ./ocr_workload --count 1000000 --tar load.tar --page-ratio 0.05
+//                  --dup-ratio 0.2 --near-dup-ratio 0.1 --noise 0.02 --skew 2
+//
+// options:
+//   --count N            images to generate (required)
+//   --seed N             default 1
+//   --out DIR            write files: DIR/NNNN/imgNNNNNNNN.png, 1000 per folder
+//   --tar FILE           write the same layout as one ustar archive instead
+//   --lines MIN-MAX      lines per image (default 1-1)
+//   --words MIN-MAX      words per line (default 1-3)
+//   --page-ratio F       share of full pages instead (default 0)
+//   --page-lines MIN-MAX lines per page (default 30-50), 8-12 words each
+//   --font-sizes LIST    point sizes, even 4-20 (default 8,10,12,14,16,20)
+//   --scale MIN-MAX      resampling after rendering (default 1-1)
+//   --noise X            up to this share of pixels flipped (default 0)
+//   --blur P             share of images blurred (default 0)
+//   --skew DEG           rotated by up to +-DEG degrees (default 0)
+//   --format FMT         png, jpeg or mix (default png)
+//   --dup-ratio F        share of exact repeats of an earlier image
+//   --near-dup-ratio F   share of recompressed, rescaled earlier images
+//   --words-file FILE    draw words from FILE (one per line) instead of
+//                        made-up ones
+//   -j N                 render threads (default: hardware threads)
+//
+// Alongside the images: labels.csv (image,text, as ocr_accuracy reads it;
+// lines of a multi-line image are separated by \n) and paths.txt (one
+// path per line in generation order, for ocr_cli -; in an archive the
+// paths are relative to where it is unpacked). Text is printable
+// ASCII, drawn with Leptonica's built-in bitmap font.
+
+#include <leptonica/allheaders.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// images rendered ahead of the one being written, at most
+constexpr size_t kWindow = 256;
+constexpr int kImagesPerFolder = 1000;
+constexpr int kMarginPx = 16;
+
+// splitmix64; the standard distributions differ between libraries, so
+// everything is derived from raw 64-bit draws to stay reproducible
+class Rng {
+public:
+    // independent streams per image and purpose
+    Rng(uint64_t seed, uint64_t index, uint64_t stream)
+        : state_(seed * 0x9E3779B97F4A7C15ull ^ (index << 8) ^ stream) { next(); }
+
+    uint64_t next() {
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // [0, 1)
+    double real() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    // [0, n)
+    uint64_t below(uint64_t n) { return n ? next() % n : 0; }
+
+    // [lo, hi]
+    int between(int lo, int hi) { return lo + static_cast<int>(below(hi - lo + 1)); }
+
+private:
+    uint64_t state_;
+};
+
+struct Range {
+    int lo = 1;
+    int hi = 1;
+};
+
+struct Options {
+    long long count = 0;
+    uint64_t seed = 1;
+    std::string outDir;
+    std::string tarFile;
+    Range lines{1, 1};
+    Range words{1, 3};
+    double pageRatio = 0;
+    Range pageLines{30, 50};
+    std::vector<int> fontSizes = {8, 10, 12, 14, 16, 20};
+    double scaleMin = 1, scaleMax = 1;
+    double noise = 0;
+    double blur = 0;
+    double skew = 0;
+    std::string format = "png";
+    double dupRatio = 0;
+    double nearDupRatio = 0;
+    std::vector<std::string> vocabulary;    // empty = made-up words
+    int threads = 0;
+};
+
+enum class Role { Original, Duplicate, NearDuplicate };
+
+struct Image {
+    std::string name;       // relative path
+    std::string bytes;
+    std::string text;
+    Role role = Role::Original;
+};
+
+const char* const kOnsets[] = {"b", "c", "d", "f", "g", "h", "l", "m", "n", "p", "r",
+                               "s", "t", "v", "w", "br", "ch", "cl", "pl", "sh", "st",
+                               "tr", "th", ""};
+const char* const kVowels[] = {"a", "e", "i", "o", "u", "ea", "ou", "io", "ai", "y"};
+const char* const kCodas[] = {"", "", "", "n", "r", "s", "t", "l", "m", "nd", "st", "ck"};
+
+template <typename T, size_t N>
+const char* pick(Rng& rng, T (&table)[N]) { return table[rng.below(N)]; }
+
+std::string makeWord(const Options& opt, Rng& rng) {
+    // numbers, as on invoices and forms
+    if (rng.real() < 0.08) {
+        char buf[32];
+        switch (rng.below(3)) {
+            case 0: std::snprintf(buf, sizeof(buf), "%d", static_cast<int>(rng.below(100000))); break;
+            case 1: std::snprintf(buf, sizeof(buf), "%d.%02d", static_cast<int>(rng.below(10000)),
+                                  static_cast<int>(rng.below(100))); break;
+            default: std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d", 1990 + rng.between(0, 40),
+                                   rng.between(1, 12), rng.between(1, 28)); break;
+        }
+        return buf;
+    }
+
+    std::string w;
+    if (!opt.vocabulary.empty()) {
+        w = opt.vocabulary[rng.below(opt.vocabulary.size())];
+    } else {
+        const int syllables = rng.between(1, 4);
+        for (int s = 0; s < syllables; s++) {
+            w += pick(rng, kOnsets);
+            w += pick(rng, kVowels);
+            w += pick(rng, kCodas);
+        }
+    }
+    if (rng.real() < 0.1 && !w.empty()) w[0] = static_cast<char>(std::toupper(w[0]));
+    return w;
+}
+
+std::string makeText(const Options& opt, Rng& rng) {
+    const bool page = rng.real() < opt.pageRatio;
+    const int lines = page ? rng.between(opt.pageLines.lo, opt.pageLines.hi)
+                           : rng.between(opt.lines.lo, opt.lines.hi);
+
+    std::string text;
+    for (int l = 0; l < lines; l++) {
+        const int words = page ? rng.between(8, 12) : rng.between(opt.words.lo, opt.words.hi);
+        if (l > 0) text += '\n';
+        for (int k = 0; k < words; k++) {
+            if (k > 0) text += ' ';
+            text += makeWord(opt, rng);
+        }
+    }
+    return text;
+}
+
+// Leptonica's fonts hand out glyphs by refcount, so each thread has its own
+L_BMF* font(int size) {
+    struct Fonts {
+        std::vector<std::pair<int, L_BMF*>> bySize;
+        ~Fonts() {
+            for (auto& entry : bySize) bmfDestroy(&entry.second);
+        }
+    };
+    thread_local Fonts fonts;
+
+    for (auto& [s, bmf] : fonts.bySize) {
+        if (s == size) return bmf;
+    }
+    L_BMF* bmf = bmfCreate(nullptr, size);
+    if (bmf) fonts.bySize.emplace_back(size, bmf);
+    return bmf;
+}
+
+// flips about share of the pixels of an 8-bit image to black or white
+void addNoise(PIX* pix, double share, Rng& rng) {
+    const int w = pixGetWidth(pix);
+    const int h = pixGetHeight(pix);
+    const int wpl = pixGetWpl(pix);
+    l_uint32* data = pixGetData(pix);
+
+    const long long n = static_cast<long long>(share * w * h);
+    for (long long k = 0; k < n; k++) {
+        l_uint32* line = data + static_cast<long long>(rng.below(h)) * wpl;
+        SET_DATA_BYTE(line, static_cast<int>(rng.below(w)), (rng.next() & 1) ? 255 : 0);
+    }
+}
+
+// the original image i as rendered, before encoding; nullptr on failure
+PIX* render(const Options& opt, uint64_t i, std::string& text, bool& jpeg) {
+    Rng rng(opt.seed, i, 1);
+    text = makeText(opt, rng);
+    const int size = opt.fontSizes[rng.below(opt.fontSizes.size())];
+    const double scale = opt.scaleMin + rng.real() * (opt.scaleMax - opt.scaleMin);
+    const double noise = rng.real() * opt.noise;
+    const bool blur = rng.real() < opt.blur;
+    const double skew = (rng.real() * 2 - 1) * opt.skew;
+    jpeg = opt.format == "jpeg" || (opt.format == "mix" && (rng.next() & 1));
+
+    L_BMF* bmf = font(size);
+    if (!bmf) return nullptr;
+
+    PIX* blank = pixCreate(1, 1, 8);
+    pixSetAll(blank);
+    PIX* lines = pixAddTextlines(blank, bmf, text.c_str(), 0, L_ADD_BELOW);
+    pixDestroy(&blank);
+    if (!lines) return nullptr;
+
+    PIX* pix = pixAddBorder(lines, kMarginPx, 255);
+    pixDestroy(&lines);
+
+    // text may come back in color; everything below works on gray
+    if (pix && pixGetDepth(pix) != 8) {
+        PIX* gray = pixConvertTo8(pix, 0);
+        pixDestroy(&pix);
+        pix = gray;
+    }
+    if (!pix) return nullptr;
+
+    if (scale != 1.0) {
+        PIX* scaled = pixScale(pix, static_cast<l_float32>(scale), static_cast<l_float32>(scale));
+        pixDestroy(&pix);
+        pix = scaled;
+    }
+    if (pix && std::abs(skew) >= 0.05) {
+        PIX* rotated = pixRotate(pix, static_cast<l_float32>(skew * M_PI / 180), L_ROTATE_AREA_MAP,
+                                 L_BRING_IN_WHITE, 0, 0);
+        pixDestroy(&pix);
+        pix = rotated;
+    }
+    if (pix && blur) {
+        PIX* blurred = pixBlockconv(pix, 1, 1);
+        pixDestroy(&pix);
+        pix = blurred;
+    }
+    if (pix && noise > 0) addNoise(pix, noise, rng);
+    return pix;
+}
+
+bool encode(PIX* pix, bool jpeg, int quality, std::string& out) {
+    l_uint8* data = nullptr;
+    size_t size = 0;
+    const int err = jpeg ? pixWriteMemJpeg(&data, &size, pix, quality, 0)
+                         : pixWriteMem(&data, &size, pix, IFF_PNG);
+    if (err || !data) return false;
+    out.assign(reinterpret_cast<const char*>(data), size);
+    lept_free(data);
+    return true;
+}
+
+// what image i is, and for repeats the original (never itself a repeat)
+// it copies
+Role role(const Options& opt, uint64_t i, uint64_t& source) {
+    source = i;
+    if (i == 0) return Role::Original;
+
+    Rng rng(opt.seed, i, 0);
+    const double r = rng.real();
+    if (r >= opt.dupRatio + opt.nearDupRatio) return Role::Original;
+
+    // earlier picks may be repeats themselves; follow them to an original
+    source = rng.below(i);
+    for (uint64_t next; role(opt, source, next) != Role::Original; source = next) {}
+    return r < opt.dupRatio ? Role::Duplicate : Role::NearDuplicate;
+}
+
+bool generate(const Options& opt, uint64_t i, Image& img) {
+    uint64_t source = i;
+    img.role = role(opt, i, source);
+
+    bool jpeg = false;
+    PIX* pix = render(opt, source, img.text, jpeg);
+    if (!pix) return false;
+
+    int quality = 85;
+    if (img.role == Role::NearDuplicate) {
+        // a re-scan: slightly rescaled and recompressed
+        Rng rng(opt.seed, i, 2);
+        const double scale = 0.9 + rng.real() * 0.2;
+        PIX* scaled = pixScale(pix, static_cast<l_float32>(scale), static_cast<l_float32>(scale));
+        pixDestroy(&pix);
+        pix = scaled;
+        jpeg = true;
+        quality = rng.between(60, 90);
+        if (!pix) return false;
+    }
+
+    const bool ok = encode(pix, jpeg, quality, img.bytes);
+    pixDestroy(&pix);
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "%04llu/img%08llu.%s",
+                  static_cast<unsigned long long>(i / kImagesPerFolder),
+                  static_cast<unsigned long long>(i), jpeg ? "jpg" : "png");
+    img.name = name;
+    return ok;
+}
+
+// Rendered images, handed to the writer in index order. A renderer
+// waits while its image is more than the window ahead of the writer, so
+// memory stays flat however many images there are.
+class OrderedSlots {
+public:
+    explicit OrderedSlots(size_t size) : slots_(size), ready_(size, false) {}
+
+    void put(long long index, Image img) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        space_.wait(lock, [&]{ return index < taken_ + static_cast<long long>(slots_.size()); });
+        slots_[index % slots_.size()] = std::move(img);
+        ready_[index % slots_.size()] = true;
+        filled_.notify_all();
+    }
+
+    // the next image in order
+    Image take() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        const size_t slot = taken_ % slots_.size();
+        filled_.wait(lock, [&]{ return ready_[slot]; });
+        Image img = std::move(slots_[slot]);
+        ready_[slot] = false;
+        taken_++;
+        space_.notify_all();
+        return img;
+    }
+
+private:
+    std::vector<Image> slots_;
+    std::vector<bool> ready_;
+    long long taken_ = 0;
+    std::mutex mtx_;
+    std::condition_variable space_;
+    std::condition_variable filled_;
+};
+
+// files under a folder, or entries of a ustar archive
+class Sink {
+public:
+    virtual ~Sink() = default;
+    virtual bool write(const std::string& name, const std::string& bytes) = 0;
+
+    // a file written a line at a time while the images are (labels.csv,
+    // paths.txt), so it is never held in memory whole; complete after
+    // close(). nullptr if it can't be created
+    virtual std::ostream* openStream(const std::string& name) = 0;
+
+    virtual bool close() = 0;
+};
+
+class DirSink : public Sink {
+public:
+    explicit DirSink(fs::path dir) : dir_(std::move(dir)) {}
+
+    bool write(const std::string& name, const std::string& bytes) override {
+        const fs::path path = dir_ / name;
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+
+        std::ofstream out(path, std::ios::binary);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        return static_cast<bool>(out);
+    }
+
+    std::ostream* openStream(const std::string& name) override {
+        std::error_code ec;
+        fs::create_directories(dir_, ec);
+
+        auto out = std::make_unique<std::ofstream>(dir_ / name, std::ios::binary);
+        if (!*out) return nullptr;
+        streams_.push_back(std::move(out));
+        return streams_.back().get();
+    }
+
+    bool close() override {
+        bool ok = true;
+        for (auto& out : streams_) {
+            out->close();
+            ok = ok && !out->fail();
+        }
+        return ok;
+    }
+
+private:
+    fs::path dir_;
+    std::vector<std::unique_ptr<std::ofstream>> streams_;
+};
+
+// Plain ustar, fixed mode and mtime, so equal inputs give equal archives.
+// Folders aren't stored; tar creates them on extraction. Streams go to
+// temporary files next to the archive and are appended to it, in the
+// order they were opened, by close().
+class TarSink : public Sink {
+public:
+    explicit TarSink(const std::string& file) : file_(file), out_(file, std::ios::binary) {}
+
+    ~TarSink() override {
+        for (auto& stream : streams_) {
+            std::error_code ec;
+            fs::remove(stream.tmpPath, ec);
+        }
+    }
+
+    bool ok() const { return static_cast<bool>(out_); }
+
+    bool write(const std::string& name, const std::string& bytes) override {
+        writeHeader(name, bytes.size());
+        out_.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        pad(bytes.size());
+        return static_cast<bool>(out_);
+    }
+
+    std::ostream* openStream(const std::string& name) override {
+        Stream stream;
+        stream.name = name;
+        stream.tmpPath = file_ + "." + name + ".tmp";
+        stream.out = std::make_unique<std::ofstream>(stream.tmpPath, std::ios::binary);
+        if (!*stream.out) return nullptr;
+        streams_.push_back(std::move(stream));
+        return streams_.back().out.get();
+    }
+
+    bool close() override {
+        for (auto& stream : streams_) {
+            stream.out->close();
+            if (stream.out->fail() || !append(stream)) return false;
+        }
+
+        static const char zeros[1024] = {};
+        out_.write(zeros, sizeof(zeros));
+        out_.close();
+        return !out_.fail();
+    }
+
+private:
+    struct Stream {
+        std::string name;
+        std::string tmpPath;
+        std::unique_ptr<std::ofstream> out;
+    };
+
+    void writeHeader(const std::string& name, size_t size) {
+        char header[512] = {};
+        std::snprintf(header, 100, "%s", name.c_str());
+        std::snprintf(header + 100, 8, "%07o", 0644);
+        std::snprintf(header + 108, 8, "%07o", 0);
+        std::snprintf(header + 116, 8, "%07o", 0);
+        std::snprintf(header + 124, 12, "%011llo", static_cast<unsigned long long>(size));
+        std::snprintf(header + 136, 12, "%011o", 0);
+        header[156] = '0';
+        std::memcpy(header + 257, "ustar", 6);
+        std::memcpy(header + 263, "00", 2);
+
+        // checksum over the header with its own field as spaces
+        std::memset(header + 148, ' ', 8);
+        unsigned sum = 0;
+        for (unsigned char c : header) sum += c;
+        std::snprintf(header + 148, 8, "%06o", sum);
+        header[155] = ' ';
+
+        out_.write(header, sizeof(header));
+    }
+
+    void pad(size_t size) {
+        static const char zeros[512] = {};
+        out_.write(zeros, (512 - size % 512) % 512);
+    }
+
+    // copies a finished stream into the archive a chunk at a time
+    bool append(const Stream& stream) {
+        std::error_code ec;
+        const auto size = fs::file_size(stream.tmpPath, ec);
+        std::ifstream in(stream.tmpPath, std::ios::binary);
+        if (ec || !in) return false;
+
+        writeHeader(stream.name, static_cast<size_t>(size));
+        std::vector<char> buf(1 << 20);
+        uintmax_t left = size;
+        while (left > 0 && in) {
+            const size_t n = static_cast<size_t>(std::min<uintmax_t>(left, buf.size()));
+            in.read(buf.data(), static_cast<std::streamsize>(n));
+            out_.write(buf.data(), in.gcount());
+            left -= static_cast<uintmax_t>(in.gcount());
+        }
+        pad(static_cast<size_t>(size));
+
+        in.close();
+        fs::remove(stream.tmpPath, ec);
+        return left == 0 && static_cast<bool>(out_);
+    }
+
+    std::string file_;
+    std::ofstream out_;
+    std::vector<Stream> streams_;
+};
+
+std::string csvField(const std::string& s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+bool parseRange(const char* s, Range& r) {
+    char* end = nullptr;
+    r.lo = static_cast<int>(std::strtol(s, &end, 10));
+    r.hi = *end == '-' ? static_cast<int>(std::strtol(end + 1, &end, 10)) : r.lo;
+    return *end == '\0' && r.lo >= 1 && r.hi >= r.lo;
+}
+
+bool parseRealRange(const char* s, double& lo, double& hi) {
+    char* end = nullptr;
+    lo = std::strtod(s, &end);
+    hi = *end == '-' ? std::strtod(end + 1, &end) : lo;
+    return *end == '\0' && lo > 0 && hi >= lo;
+}
+
+bool loadVocabulary(const std::string& file, std::vector<std::string>& out) {
+    std::ifstream in(file);
+    std::string w;
+    while (std::getline(in, w)) {
+        // the bitmap font has printable ASCII only
+        const bool printable = !w.empty() && std::all_of(w.begin(), w.end(), [](char c) {
+            return c > ' ' && c < 127;
+        });
+        if (printable) out.push_back(w);
+    }
+    return !out.empty();
+}
+
+void printUsage() {
+    std::cerr <<
+        "usage: ocr_workload --count N (--out DIR | --tar FILE) [--seed N]\n"
+        "                    [--lines MIN-MAX] [--words MIN-MAX]\n"
+        "                    [--page-ratio F] [--page-lines MIN-MAX]\n"
+        "                    [--font-sizes 8,12,...] [--scale MIN-MAX]\n"
+        "                    [--noise X] [--blur P] [--skew DEG] [--format png|jpeg|mix]\n"
+        "                    [--dup-ratio F] [--near-dup-ratio F] [--words-file FILE] [-j N]\n";
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!value) return false;
+
+        if (arg == "--count") {
+            opt.count = std::atoll(value);
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--out") {
+            opt.outDir = value;
+        } else if (arg == "--tar") {
+            opt.tarFile = value;
+        } else if (arg == "--lines") {
+            if (!parseRange(value, opt.lines)) return false;
+        } else if (arg == "--words") {
+            if (!parseRange(value, opt.words)) return false;
+        } else if (arg == "--page-ratio") {
+            opt.pageRatio = std::atof(value);
+        } else if (arg == "--page-lines") {
+            if (!parseRange(value, opt.pageLines)) return false;
+        } else if (arg == "--font-sizes") {
+            opt.fontSizes.clear();
+            std::stringstream ss(value);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                const int size = std::atoi(item.c_str());
+                if (size < 4 || size > 20 || size % 2) return false;
+                opt.fontSizes.push_back(size);
+            }
+            if (opt.fontSizes.empty()) return false;
+        } else if (arg == "--scale") {
+            if (!parseRealRange(value, opt.scaleMin, opt.scaleMax)) return false;
+        } else if (arg == "--noise") {
+            opt.noise = std::clamp(std::atof(value), 0.0, 1.0);
+        } else if (arg == "--blur") {
+            opt.blur = std::atof(value);
+        } else if (arg == "--skew") {
+            opt.skew = std::abs(std::atof(value));
+        } else if (arg == "--format") {
+            opt.format = value;
+            if (opt.format != "png" && opt.format != "jpeg" && opt.format != "mix") return false;
+        } else if (arg == "--dup-ratio") {
+            opt.dupRatio = std::clamp(std::atof(value), 0.0, 1.0);
+        } else if (arg == "--near-dup-ratio") {
+            opt.nearDupRatio = std::clamp(std::atof(value), 0.0, 1.0);
+        } else if (arg == "--words-file") {
+            if (!loadVocabulary(value, opt.vocabulary)) {
+                std::cerr << "[Workload] No usable words in " << value << std::endl;
+                return false;
+            }
+        } else if (arg == "-j") {
+            opt.threads = std::max(1, std::atoi(value));
+        } else {
+            return false;
+        }
+        i++;
+    }
+    return opt.count > 0 && (opt.outDir.empty() != opt.tarFile.empty()) &&
+           opt.dupRatio + opt.nearDupRatio <= 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        printUsage();
+        return 2;
+    }
+    if (opt.threads == 0) opt.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::unique_ptr<Sink> sink;
+    if (!opt.tarFile.empty()) {
+        auto tar = std::make_unique<TarSink>(opt.tarFile);
+        if (!tar->ok()) {
+            std::cerr << "[Workload] Cannot create " << opt.tarFile << std::endl;
+            return 1;
+        }
+        sink = std::move(tar);
+    } else {
+        sink = std::make_unique<DirSink>(opt.outDir);
+    }
+
+    // written as images come out, so memory stays flat however many;
+    // paths.txt points at the files where ocr_cli will find them
+    const fs::path pathPrefix = opt.outDir.empty() ? fs::path() : fs::path(opt.outDir);
+    std::ostream* labels = sink->openStream("labels.csv");
+    std::ostream* paths = sink->openStream("paths.txt");
+    if (!labels || !paths) {
+        std::cerr << "[Workload] Cannot create the index files" << std::endl;
+        return 1;
+    }
+    *labels << "image,text\n";
+    long long counts[3] = {};
+    long long bytes = 0;
+    long long failed = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    OrderedSlots rendered(kWindow);
+    std::atomic<long long> next{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opt.threads; t++) {
+        threads.emplace_back([&] {
+            for (long long i = next++; i < opt.count; i = next++) {
+                Image img;
+                if (!generate(opt, i, img)) img.bytes.clear();
+                rendered.put(i, std::move(img));
+            }
+        });
+    }
+
+    bool writeOk = true;
+    for (long long i = 0; i < opt.count; i++) {
+        Image img = rendered.take();
+        if (img.bytes.empty()) {
+            failed++;
+            continue;
+        }
+        if (writeOk && !sink->write(img.name, img.bytes)) {
+            // keep draining so the renderers can finish
+            std::cerr << "[Workload] Write failed: " << img.name << std::endl;
+            writeOk = false;
+        }
+        *labels << img.name << "," << csvField(img.text) << "\n";
+        *paths << (pathPrefix / img.name).string() << "\n";
+        counts[static_cast<int>(img.role)]++;
+        bytes += static_cast<long long>(img.bytes.size());
+
+        if ((i + 1) % 10000 == 0) {
+            std::cerr << "[Workload] " << i + 1 << "/" << opt.count << " images" << std::endl;
+        }
+    }
+    for (auto& t : threads) t.join();
+    if (!writeOk) return 1;
+
+    if (!sink->close()) {
+        std::cerr << "[Workload] Writing the index files failed" << std::endl;
+        return 1;
+    }
+
+    const double secs = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cerr << "[Workload] " << opt.count - failed << " images (" << counts[0] << " original, "
+              << counts[1] << " duplicate, " << counts[2] << " near-duplicate) | "
+              << (bytes >> 20) << " MB | " << secs << " s | seed " << opt.seed << std::endl;
+    if (failed > 0) std::cerr << "[Workload] Failed to render: " << failed << std::endl;
+    return failed > 0 ? 1 : 0;
+}
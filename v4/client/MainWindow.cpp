@@ -1,112 +1,109 @@
 #include "MainWindow.h"
-#include <QFileDialog>
 #include <QBuffer>
-#include <QPixmap>
-#include <thread>
-
-
-// Server address configuration
-static constexpr const char* kServerAddress = "192.168.1.12:50051";
+#include <QFile>
+#include <QFileDialog>
+#include <QImageReader>
+#include <QScrollBar>
 
-// represents one OCR card (image + result)
-ImageItemWidget::ImageItemWidget(QWidget* parent)
-    : QWidget(parent),
-      imgLabel(new QLabel(this)),
-      resultLabel(new QLabel(this))
-{
-    setStyleSheet("background-color: transparent;");
-    setFixedSize(210, 140);
 
-    imgLabel->setAlignment(Qt::AlignCenter);
-    resultLabel->setAlignment(Qt::AlignCenter);
+namespace {
 
-    imgLabel->setStyleSheet(
-        "background-color: transparent;"
-        "padding: 0px;"
-    );
+// what a card keeps of a result that went to the export file
+constexpr int kExportPreviewChars = 160;
 
-    resultLabel->setStyleSheet(
-        "background-color: transparent;"
-        "color: #ffffff;"
-        "font-size: 13px;"
-    );
+// files read and in flight at once, however many are selected
+constexpr int kSendThreads = 8;
 
-    auto* layout = new QVBoxLayout(this);
-    layout->setContentsMargins(2, 2, 2, 2);
-    layout->setSpacing(2);
-    layout->addWidget(imgLabel);
-    layout->addWidget(resultLabel);
-    setLayout(layout);
-}
-
-void ImageItemWidget::setImage(const QImage& img) {
-    imgLabel->setPixmap(
-        QPixmap::fromImage(img).scaled(
-            180, 45,
-            Qt::KeepAspectRatio,
-            Qt::SmoothTransformation
-        )
-    );
+QString cardText(const std::string& text, bool exported) {
+    QString s = QString::fromStdString(text);
+    if (exported && s.size() > kExportPreviewChars) {
+        s.truncate(kExportPreviewChars);
+        s += QChar(0x2026);
+    }
+    return s;
 }
 
-void ImageItemWidget::setResult(const QString& text) {
-    resultLabel->setText(text);
-}
+} // namespace
 
-// creates a channel to the server and sends OCR requests
 OcrClient::OcrClient(QObject* parent)
     : QObject(parent)
 {
-    std::cout << "[Client] Creating channel to server at "
-              << kServerAddress << "..." << std::endl;
-
-    auto channel = grpc::CreateChannel(
-        kServerAddress,
-        grpc::InsecureChannelCredentials()
-    );
-
-    stub_ = ocr::OcrService::NewStub(channel);
+    pool_.setMaxThreadCount(kSendThreads);
+}
 
-    std::cout << "[Client] Connection established (stub created)." << std::endl;
+OcrClient::~OcrClient() {
+    // queued files are dropped; running sends use rpc_ and updates_
+    pool_.clear();
+    pool_.waitForDone();
 }
 
-void OcrClient::sendImage(
+// reads and sends files without blocking the UI thread; lines are shown
+// as the server streams them, then replaced by the full text
+void OcrClient::sendFile(
     qint64 batchId,
     int index,
-    const QString& filename,
-    const QByteArray& imgData
+    const QString& path
 ) {
-    std::thread([=]() {
-        ocr::OcrRequest req;
-        req.set_batch_id(batchId);
-        req.set_image_index(index);
-        req.set_filename(filename.toStdString());
-        req.set_image_data(std::string(imgData.constData(), imgData.size()));
-
-        ocr::OcrResponse res;
-        grpc::ClientContext ctx;
-
-        grpc::Status status = stub_->RecognizeImage(&ctx, req, &res);
-
-        if (!status.ok()) {
-            emit resultReady(batchId, index, filename, "",
-                             false,
-                             QString::fromStdString(status.error_message()),
-                             0);
-        } else {
-            emit resultReady(batchId, index,
-                             QString::fromStdString(res.filename()),
-                             QString::fromStdString(res.text()),
-                             res.success(),
-                             QString::fromStdString(res.error_message()),
-                             res.processing_time_ms());
+    pool_.start([=, this, exporter = exporter_]() {
+        QString filename = QFileInfo(path).fileName();
+
+        // the file's own bytes; the server decodes PNG/JPEG/BMP/TIFF itself.
+        // only the header is checked here, nothing is decoded
+        QFile file(path);
+        QByteArray data;
+        if (file.open(QIODevice::ReadOnly)) data = file.readAll();
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        if (data.isEmpty() || !QImageReader(&buffer).canRead()) {
+            OcrUpdate update;
+            update.batchId = batchId;
+            update.index = index;
+            update.filename = filename;
+            update.error = "Invalid image";
+
+            if (exporter) {
+                OcrRpcResult res;
+                res.filename = filename.toStdString();
+                res.error = "Invalid image";
+                exporter->write(index, path.toStdString(), res);
+            }
+            updates_.push(std::move(update));
+            return;
         }
-    }).detach();
+
+        OcrRpcResult res = rpc_.recognizeStream(
+            batchId, index, filename.toStdString(),
+            std::string(data.constData(), data.size()),
+            [&](const ocr::OcrPartial& p) {
+                OcrUpdate update;
+                update.partial = true;
+                update.batchId = batchId;
+                update.index = index;
+                update.text = QString::fromStdString(p.text());
+                updates_.push(std::move(update));
+            }
+        );
+
+        // written before the update is queued, so once the GUI has seen
+        // every result the exporter has them all too
+        if (exporter) exporter->write(index, path.toStdString(), res);
+
+        OcrUpdate update;
+        update.batchId = batchId;
+        update.index = index;
+        update.filename = QString::fromStdString(res.filename);
+        update.text = cardText(res.text, exporter != nullptr);
+        update.success = res.success;
+        update.error = QString::fromStdString(res.error);
+        update.ms = res.ms;
+        updates_.push(std::move(update));
+    });
 }
 
 // the entire interface
 MainWindow::MainWindow(QWidget* parent)
-    : QMainWindow(parent)
+    : QMainWindow(parent),
+      thumbnails_(ResultDelegate::thumbnailSize())
 {
     setMinimumSize(1200, 800);
     setStyleSheet("background-color: #303030; color: white;");
@@ -125,6 +122,10 @@ MainWindow::MainWindow(QWidget* parent)
         "border-radius: 4px;"
     );
 
+    // export button
+    exportButton_ = new QPushButton("Export Results...", this);
+    exportButton_->setStyleSheet(uploadButton_->styleSheet());
+
     // progress bar
     progressBar_ = new QProgressBar(this);
     progressBar_->setRange(0, 100);
@@ -141,24 +142,31 @@ MainWindow::MainWindow(QWidget* parent)
         "}"
     );
 
-    // scroll area
-    scrollArea_ = new QScrollArea(this);
-    scrollArea_->setStyleSheet("background-color: #303030;");
-    scrollArea_->setWidgetResizable(true);
-
-    scrollContent_ = new QWidget(this);
-    gridLayout_ = new QGridLayout(scrollContent_);
-    gridLayout_->setContentsMargins(10, 10, 10, 10);
-    gridLayout_->setHorizontalSpacing(24);
-    gridLayout_->setVerticalSpacing(28);
-
-    scrollContent_->setLayout(gridLayout_);
-    scrollArea_->setWidget(scrollContent_);
+    // results grid: a card per image, flowed into as many columns as fit
+    model_ = new ResultsModel(&thumbnails_, this);
+
+    resultsView_ = new QListView(this);
+    resultsView_->setStyleSheet("background-color: #303030; border: none;");
+    resultsView_->setViewMode(QListView::IconMode);
+    resultsView_->setMovement(QListView::Static);
+    resultsView_->setResizeMode(QListView::Adjust);
+    resultsView_->setUniformItemSizes(true);
+    resultsView_->setLayoutMode(QListView::Batched);
+    resultsView_->setBatchSize(1000);
+    resultsView_->setSelectionMode(QAbstractItemView::NoSelection);
+    resultsView_->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    resultsView_->setViewportMargins(10, 10, 10, 10);
+    resultsView_->setGridSize(ResultDelegate::cardSize() + QSize(24, 28));
+    resultsView_->setItemDelegate(new ResultDelegate(resultsView_));
+    resultsView_->setModel(model_);
 
     // add to layout
-    mainLayout_->addWidget(uploadButton_);
+    auto* buttons = new QHBoxLayout();
+    buttons->addWidget(uploadButton_, 1);
+    buttons->addWidget(exportButton_);
+    mainLayout_->addLayout(buttons);
     mainLayout_->addWidget(progressBar_);
-    mainLayout_->addWidget(scrollArea_);
+    mainLayout_->addWidget(resultsView_);
 
     centralWidget_->setLayout(mainLayout_);
     setCentralWidget(centralWidget_);
@@ -166,18 +174,30 @@ MainWindow::MainWindow(QWidget* parent)
     connect(uploadButton_, &QPushButton::clicked,
             this, &MainWindow::onUploadClicked);
 
-    connect(&client_, &OcrClient::resultReady,
-            this, &MainWindow::onResult);
+    connect(exportButton_, &QPushButton::clicked,
+            this, &MainWindow::onExportClicked);
+
+    // ~60 Hz while results are coming in
+    updateTimer_.setInterval(16);
+    connect(&updateTimer_, &QTimer::timeout,
+            this, &MainWindow::applyUpdates);
+
+    connect(&thumbnails_, &ThumbnailLoader::thumbnailReady,
+            model_, &ResultsModel::setThumbnail);
+
+    // previews queued for cards that have scrolled away aren't worth
+    // decoding; the cards now in view ask again when they are painted
+    connect(resultsView_->verticalScrollBar(), &QScrollBar::valueChanged,
+            this, [this]() {
+                thumbnails_.cancelPending();
+                model_->forgetPendingThumbnails();
+            });
 }
 
 // clears old results when starting a new batch
 void MainWindow::clearUI() {
-    QLayoutItem* item;
-    while ((item = gridLayout_->takeAt(0)) != nullptr) {
-        delete item->widget();
-        delete item;
-    }
-    widgets_.clear();
+    thumbnails_.cancelPending();
+    model_->clear();
 }
 
 void MainWindow::prepareNewBatchIfNeeded() {
@@ -222,81 +242,119 @@ void MainWindow::onUploadClicked() {
     std::cout << "[Client] Total images selected: " 
               << files.size() << std::endl;
 
-    for (const QString& path : files) {
-        QImage img(path);
-        if (img.isNull()) {
-            std::cout << "[Client] Invalid image skipped: " 
-                      << path.toStdString() << std::endl;
-            continue;
+    if (!exportPath_.isEmpty() && !exporter_) {
+        std::string path = exportPath_.toStdString();
+        std::string error;
+        exporter_ = ResultExporter::open(path, exportFormatForPath(path), error);
+        if (exporter_) {
+            std::cout << "[Client] Streaming results to " << path << std::endl;
+        } else {
+            std::cout << "[Client] Cannot export results: " << error << std::endl;
         }
+        client_.setExporter(exporter_);
+    }
+
+    // one row per file, in selection order; index == row
+    int first = model_->addFiles(currentBatchId_, files);
 
-        int index = nextIndex_++;
+    for (int i = 0; i < files.size(); i++) {
+        int index = first + i;
+        nextIndex_++;
         totalImages_++;
 
-        std::cout << "[Client] Uploading image: " 
-                  << QFileInfo(path).fileName().toStdString()
+        std::cout << "[Client] Uploading image: "
+                  << QFileInfo(files[i]).fileName().toStdString()
                   << " | Index: " << index << std::endl;
 
-        // create card widget
-        auto* item = new ImageItemWidget(scrollContent_);
-        item->setImage(img);
-        item->setResult("In progress...");
-        widgets_[index] = item;
-
-        // add to grid in correct ordered position
-        int row = index / columns_;
-        int col = index % columns_;
-        gridLayout_->addWidget(item, row, col);
-
-        // convert PNG to send
-        QByteArray data;
-        QBuffer buffer(&data);
-        buffer.open(QIODevice::WriteOnly);
-        img.save(&buffer, "PNG");
-
         // send to server
-        client_.sendImage(currentBatchId_, index,
-                          QFileInfo(path).fileName(), data);
+        client_.sendFile(currentBatchId_, index, files[i]);
     }
 
     updateProgress();
+    updateTimer_.start();
 }
 
-// updates the exact widget corresponding to that image index
-void MainWindow::onResult(
-    qint64 batchId,
-    int index,
-    const QString& filename,
-    const QString& text,
-    bool success,
-    const QString& error,
-    qint64 ms)
-{
-    if (batchId != currentBatchId_) return;
+// the file applies to the next batch; choosing nothing turns export off
+void MainWindow::onExportClicked() {
+    if (exporter_) return;  // a batch is being written already
 
-    std::cout << "[Client] Received result for index " << index
-              << " | File: " << filename.toStdString()
-              << " | Success: " << (success ? "true" : "false")
-              << " | Time: " << ms << " ms" << std::endl;
+    exportPath_ = QFileDialog::getSaveFileName(
+        this, "Export results to", "",
+        "JSON Lines (*.jsonl);;CSV (*.csv);;Columnar (*.ocrc)"
+    );
 
-    completed_++;
-    updateProgress();
+    exportButton_->setText(exportPath_.isEmpty()
+        ? "Export Results..."
+        : "Exporting to " + QFileInfo(exportPath_).fileName());
+}
 
-    auto* item = widgets_.value(index);
-    if (!item) return;
+// every result of the batch is in the exporter by now
+void MainWindow::finishExport() {
+    if (!exporter_) return;
 
-    if (!success) {
-        std::cout << "[Client] ERROR for file " 
-                  << filename.toStdString() 
-                  << ": " << error.toStdString() << std::endl;
-        item->setResult("Error: " + error);
+    std::string error;
+    if (exporter_->close(error)) {
+        std::cout << "[Client] Wrote " << exporter_->records() << " results to "
+                  << exportPath_.toStdString() << std::endl;
     } else {
-        item->setResult(text);
+        std::cout << "[Client] Export to " << exportPath_.toStdString()
+                  << " failed: " << error << std::endl;
     }
 
-    if (completed_ == totalImages_) {
-        std::cout << "[Client] Batch " << batchId 
-                  << " processing complete! 100%" << std::endl;
-    }
+    // one file per batch; the next one would overwrite it
+    exporter_.reset();
+    client_.setExporter(nullptr);
+    exportPath_.clear();
+    exportButton_->setText("Export Results...");
 }
 
+// updates the cards, progress bar and log for what arrived since the last
+// tick; a burst too big for one frame is finished over the next ones
+void MainWindow::applyUpdates() {
+    int received = 0;
+    int failed = 0;
+    long long totalMs = 0;
+
+    client_.takeUpdates([&](OcrUpdate&& u) {
+        if (u.batchId != currentBatchId_) return;
+
+        if (u.partial) {
+            model_->appendPartial(u.index, u.text);
+            return;
+        }
+
+        received++;
+        completed_++;
+        totalMs += u.ms;
+
+        if (!u.success) {
+            failed++;
+            std::cout << "[Client] ERROR for file "
+                      << u.filename.toStdString()
+                      << ": " << u.error.toStdString() << std::endl;
+            model_->setResult(u.index, "Error: " + u.error);
+        } else {
+            model_->setResult(u.index, u.text);
+        }
+    });
+
+    model_->flushChanges();
+
+    if (received > 0) {
+        updateProgress();
+
+        std::cout << "[Client] Received " << received << " result(s)"
+                  << " | Failed: " << failed
+                  << " | Avg time: " << totalMs / received << " ms"
+                  << " | Done: " << completed_ << "/" << totalImages_ << std::endl;
+
+        if (completed_ == totalImages_) {
+            std::cout << "[Client] Batch " << currentBatchId_
+                      << " processing complete! 100%" << std::endl;
+            finishExport();
+        }
+    }
+
+    // nothing left in flight; the next upload restarts the timer
+    if (completed_ == totalImages_) updateTimer_.stop();
+}
@@ -1,32 +1,22 @@
 #pragma once
 
 #include <QMainWindow>
-#include <QGridLayout>
-#include <QScrollArea>
+#include <QListView>
 #include <QProgressBar>
 #include <QPushButton>
-#include <QLabel>
-#include <QMap>
-#include <QImage>
 #include <QFileInfo>
+#include <QHBoxLayout>
+#include <QThreadPool>
+#include <QTimer>
 #include <QVBoxLayout>
 
-#include <grpcpp/grpcpp.h>
-#include "ocr.grpc.pb.h"
-
-
-class ImageItemWidget : public QWidget {
-    Q_OBJECT
-public:
-    explicit ImageItemWidget(QWidget* parent = nullptr);
-
-    void setImage(const QImage& img);       // set the preview image
-    void setResult(const QString& text);    // set the OCR text
-
-private:
-    QLabel* imgLabel;
-    QLabel* resultLabel;
-};
+#include "MpscBuffer.h"
+#include "OcrRpcClient.h"
+#include "OcrUpdate.h"
+#include "ResultDelegate.h"
+#include "ResultExport.h"
+#include "ResultsModel.h"
+#include "ThumbnailLoader.h"
 
 
 class OcrClient : public QObject {
@@ -34,28 +24,37 @@ class OcrClient : public QObject {
 
 public:
     explicit OcrClient(QObject* parent = nullptr);
+    ~OcrClient() override;
 
-    // sends one image to the server for processing
-    void sendImage(
+    // queues one image file; it is read and sent once one of the send
+    // threads gets to it, so only files in flight are held in memory
+    void sendFile(
         qint64 batchId,
         int index,
-        const QString& filename,
-        const QByteArray& imgData
+        const QString& path
     );
 
-signals:
-    void resultReady(
-        qint64 batchId,
-        int index,
-        QString filename,
-        QString text,
-        bool success,
-        QString error,
-        qint64 ms
-    );
+    // Lines and results from the RPC threads, in arrival order. They are
+    // buffered rather than signalled one by one so the GUI can apply a
+    // burst per frame; see drainForOneTick() for how much.
+    template <typename F>
+    size_t takeUpdates(F&& f) { return drainForOneTick(updates_, std::forward<F>(f)); }
+
+    // results of files sent from now on are also written here, and their
+    // cards only keep a preview of the text; nullptr = keep everything
+    void setExporter(std::shared_ptr<ResultExporter> exporter) { exporter_ = std::move(exporter); }
+
+    // send each image's SHA-256 before its bytes, so a server with a result
+    // cache answers re-runs without the upload; off by default, since
+    // against a server without one it only adds a round trip per image.
+    // set before the first sendFile()
+    void setHashFirst(bool on) { rpc_.setHashFirst(on); }
 
 private:
-    std::unique_ptr<ocr::OcrService::Stub> stub_;
+    OcrRpcClient rpc_;
+    std::shared_ptr<ResultExporter> exporter_;
+    MpscBuffer<OcrUpdate> updates_;
+    QThreadPool pool_;
 };
 
 
@@ -65,32 +64,37 @@ class MainWindow : public QMainWindow {
 public:
     explicit MainWindow(QWidget* parent = nullptr);
 
+    // see OcrClient::setHashFirst
+    void setHashFirst(bool on) { client_.setHashFirst(on); }
+
 private slots:
     // when the user clicks "Upload Images"
     void onUploadClicked();
 
-    // when an OCR result is returned from server
-    void onResult(
-        qint64 batchId,
-        int index,
-        const QString& filename,
-        const QString& text,
-        bool success,
-        const QString& error,
-        qint64 ms
-    );
+    // picks the file the next batch's results are streamed to
+    void onExportClicked();
+
+    // once per frame while a batch runs: applies every line and result
+    // that arrived since the last tick
+    void applyUpdates();
 
 private:
     QWidget* centralWidget_;
     QVBoxLayout* mainLayout_;
     QPushButton* uploadButton_;
+    QPushButton* exportButton_;
     QProgressBar* progressBar_;
 
-    QScrollArea* scrollArea_;
-    QWidget* scrollContent_;
-    QGridLayout* gridLayout_;
+    // only the cards in view are painted, and only their previews decoded
+    QListView* resultsView_;
+    ResultsModel* model_;
 
     OcrClient client_;
+    ThumbnailLoader thumbnails_;
+    QTimer updateTimer_;
+
+    QString exportPath_;
+    std::shared_ptr<ResultExporter> exporter_;
 
     qint64 currentBatchId_ = 1;
     int nextIndex_ = 0;
@@ -98,11 +102,8 @@ private:
     int completed_ = 0;
     bool batchFinished_ = false;
 
-    QMap<int, ImageItemWidget*> widgets_;
-
-    const int columns_ = 4;
-
     void updateProgress();
     void clearUI();
     void prepareNewBatchIfNeeded();
+    void finishExport();
 };
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Lock-free multi-producer / single-consumer buffer. Producers push from
+// any thread without ever blocking; the consumer takes everything pushed so
+// far in one exchange and gets it back in push order.
+template <typename T>
+class MpscBuffer {
+public:
+    MpscBuffer() = default;
+    MpscBuffer(const MpscBuffer&) = delete;
+    MpscBuffer& operator=(const MpscBuffer&) = delete;
+
+    ~MpscBuffer() {
+        drain([](T&&) {});
+    }
+
+    void push(T value) {
+        Node* node = new Node{std::move(value), head_.load(std::memory_order_relaxed)};
+        while (!head_.compare_exchange_weak(node->next, node,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        }
+    }
+
+    // nothing pushed and not yet handed out; consumer thread only
+    bool empty() const {
+        return backlog_ == nullptr && head_.load(std::memory_order_acquire) == nullptr;
+    }
+
+    // calls f on the oldest items pushed before the call, in push order,
+    // up to maxItems of them; the rest are kept for the next drain.
+    // consumer thread only. returns how many f got
+    template <typename F>
+    size_t drain(F&& f, size_t maxItems = SIZE_MAX) {
+        Node* list = head_.exchange(nullptr, std::memory_order_acquire);
+
+        // pushes prepend, so reverse to get arrival order, and queue it
+        // behind what an earlier drain left
+        Node* ordered = nullptr;
+        Node* last = list;
+        while (list) {
+            Node* next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+        if (ordered) {
+            if (backlogTail_) backlogTail_->next = ordered;
+            else backlog_ = ordered;
+            backlogTail_ = last;
+        }
+
+        size_t n = 0;
+        while (backlog_ && n < maxItems) {
+            Node* next = backlog_->next;
+            f(std::move(backlog_->value));
+            delete backlog_;
+            backlog_ = next;
+            n++;
+        }
+        if (!backlog_) backlogTail_ = nullptr;
+        return n;
+    }
+
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    std::atomic<Node*> head_{nullptr};
+
+    // taken from head_ but not handed out yet, oldest first; consumer only
+    Node* backlog_ = nullptr;
+    Node* backlogTail_ = nullptr;
+};
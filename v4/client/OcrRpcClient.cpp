@@ -0,0 +1,391 @@
+#include "OcrRpcClient.h"
+#include "Sha256.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+// creates a channel to the server; the stub is shared by all calling threads
+OcrRpcClient::OcrRpcClient(const std::string& address)
+    : address_(address)
+{
+    std::cerr << "[Client] Creating channel to server at "
+              << address_ << "..." << std::endl;
+
+    auto channel = grpc::CreateChannel(
+        address_,
+        grpc::InsecureChannelCredentials()
+    );
+
+    stub_ = ocr::OcrService::NewStub(channel);
+
+    std::cerr << "[Client] Connection established (stub created)." << std::endl;
+}
+
+namespace {
+
+long long elapsedUs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - since).count();
+}
+
+void fromResponse(const ocr::OcrResponse& res, OcrRpcResult& result) {
+    result.filename = res.filename();
+    result.text = res.text();
+    result.success = res.success();
+    result.error = res.error_message();
+    result.ms = res.processing_time_ms();
+    result.confidence = res.confidence();
+    result.escalated = res.escalated();
+    result.cacheHit = res.cache_hit();
+    result.nearDuplicate = res.near_duplicate();
+    result.expectedMs = res.expected_ms();
+
+    const ocr::StageTimings& t = res.timings();
+    result.timings.queuedUs = t.queued_us();
+    result.timings.dequeuedUs = t.dequeued_us();
+    result.timings.decodedUs = t.decoded_us();
+    result.timings.recognizedUs = t.recognized_us();
+    result.timings.delayDoneUs = t.delay_done_us();
+    result.timings.completedUs = t.completed_us();
+    result.timings.respondedUs = t.responded_us();
+    result.timings.workerId = res.has_timings() ? t.worker_id() : -1;
+    switch (res.model_tier()) {
+        case ocr::MODEL_TIER_FAST:     result.modelTier = "fast"; break;
+        case ocr::MODEL_TIER_STANDARD: result.modelTier = "standard"; break;
+        case ocr::MODEL_TIER_BEST:     result.modelTier = "best"; break;
+        default: break;
+    }
+}
+
+// One hedged RecognizeImage, shared with the callbacks so that the
+// losing call can finish after the caller has its answer.
+struct HedgedCall : std::enable_shared_from_this<HedgedCall> {
+    struct Attempt {
+        grpc::ClientContext ctx;
+        ocr::OcrResponse res;
+        grpc::Status status;
+        bool done = false;
+        long long finishedUs = 0;
+    };
+
+    ocr::OcrRequest req;
+    std::shared_ptr<RequestHedger> hedger;
+    std::chrono::steady_clock::time_point start;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    Attempt attempts[2];
+    int launched = 0;
+    int winner = -1;        // set once the caller has its answer
+    bool measure = false;   // primary left running after its hedge won
+
+    void launch(int i, ocr::OcrService::Stub* stub) {
+        launched = i + 1;
+        auto self = shared_from_this();
+        stub->async()->RecognizeImage(&attempts[i].ctx, &req, &attempts[i].res,
+            [self, i](grpc::Status status) { self->finished(i, std::move(status)); });
+    }
+
+    void finished(int i, grpc::Status status) {
+        std::lock_guard<std::mutex> lock(mtx);
+        Attempt& a = attempts[i];
+        a.status = std::move(status);
+        a.finishedUs = elapsedUs(start);
+        a.done = true;
+
+        // the primary a won hedge was measured against
+        if (i == 0 && measure && a.status.ok()) {
+            hedger->recordMeasured(attempts[winner].finishedUs, a.finishedUs);
+        }
+        cv.notify_all();
+    }
+
+    // index of the earliest success, or -1
+    int firstOk() const {
+        int best = -1;
+        for (int i = 0; i < launched; i++) {
+            const Attempt& a = attempts[i];
+            if (a.done && a.status.ok() &&
+                (best < 0 || a.finishedUs < attempts[best].finishedUs)) {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    bool allDone() const {
+        for (int i = 0; i < launched; i++) {
+            if (!attempts[i].done) return false;
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+ocr::OcrRequest OcrRpcClient::makeRequest(
+    int64_t batchId,
+    int index,
+    const std::string& filename,
+    std::string imageData,
+    ShmRing::Lease& slot
+) const {
+    ocr::OcrRequest req;
+    req.set_batch_id(batchId);
+    req.set_image_index(index);
+    req.set_filename(filename);
+    *req.mutable_options() = options_;
+
+    if (ring_ && imageData.size() <= ring_->slotSize()) {
+        slot = ring_->tryAcquire();
+    }
+    if (slot) {
+        std::memcpy(slot.data(), imageData.data(), imageData.size());
+        ShmSlotHandle handle = slot.commit(imageData.size());
+
+        ocr::ShmSlot* s = req.mutable_shm_slot();
+        s->set_segment(handle.segment);
+        s->set_slot(handle.slot);
+        s->set_generation(handle.generation);
+        s->set_length(handle.length);
+    } else {
+        req.set_image_data(std::move(imageData));
+    }
+    return req;
+}
+
+bool OcrRpcClient::lookupCached(
+    int64_t batchId,
+    int index,
+    const std::string& filename,
+    const std::string& contentSha256,
+    OcrRpcResult& result
+) {
+    ocr::OcrRequest req;
+    req.set_batch_id(batchId);
+    req.set_image_index(index);
+    req.set_filename(filename);
+    req.set_content_sha256(contentSha256);
+    *req.mutable_options() = options_;
+
+    ocr::OcrResponse res;
+    grpc::ClientContext ctx;
+    grpc::Status status = stub_->RecognizeImage(&ctx, req, &res);
+
+    // anything but a hit (a miss, an error, a server without a cache)
+    // falls through to a normal upload
+    if (!status.ok() || !res.cache_hit()) return false;
+
+    fromResponse(res, result);
+    return true;
+}
+
+void OcrRpcClient::enableHedging(const std::vector<std::string>& addresses,
+                                 const HedgePolicy& policy) {
+    for (const std::string& address : addresses) {
+        std::cerr << "[Client] Creating hedge channel to " << address << "..." << std::endl;
+        hedgeStubs_.push_back(ocr::OcrService::NewStub(
+            grpc::CreateChannel(address, grpc::InsecureChannelCredentials())));
+    }
+    if (!hedgeStubs_.empty()) hedger_ = std::make_shared<RequestHedger>(policy);
+}
+
+HedgeStats OcrRpcClient::hedgeStats() const {
+    return hedger_ ? hedger_->stats() : HedgeStats();
+}
+
+grpc::Status OcrRpcClient::call(ocr::OcrRequest req, ocr::OcrResponse& res) {
+    // a shared-memory slot is only readable by the server on this host
+    if (!hedger_ || req.has_shm_slot()) {
+        grpc::ClientContext ctx;
+        return stub_->RecognizeImage(&ctx, req, &res);
+    }
+
+    auto race = std::make_shared<HedgedCall>();
+    race->req = std::move(req);
+    race->hedger = hedger_;
+    race->start = std::chrono::steady_clock::now();
+
+    const long long delayUs = hedger_->admit();
+    race->launch(0, stub_.get());
+
+    if (delayUs >= 0) {
+        std::unique_lock<std::mutex> lock(race->mtx);
+        bool answered = race->cv.wait_for(lock, std::chrono::microseconds(delayUs),
+                                          [&]{ return race->attempts[0].done; });
+        lock.unlock();
+
+        // a primary that failed fast is reported as is, not retried
+        if (!answered && hedger_->tryHedge()) {
+            size_t next = nextHedge_.fetch_add(1, std::memory_order_relaxed);
+            race->launch(1, hedgeStubs_[next % hedgeStubs_.size()].get());
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(race->mtx);
+    race->cv.wait(lock, [&]{ return race->firstOk() >= 0 || race->allDone(); });
+    const int winner = std::max(race->firstOk(), 0);
+    HedgedCall::Attempt& won = race->attempts[winner];
+
+    if (won.status.ok()) {
+        if (winner == 0) {
+            hedger_->record(won.finishedUs, won.finishedUs);
+        } else if (race->attempts[0].done) {
+            hedger_->recordCut(won.finishedUs);
+        } else if (hedger_->hedgeWon()) {
+            race->measure = true;
+        } else {
+            hedger_->recordCut(won.finishedUs);
+        }
+    }
+    race->winner = winner;
+
+    // the loser finishes on its own; the callbacks keep race alive
+    for (int i = 0; i < race->launched; i++) {
+        if (i != winner && !race->attempts[i].done && !race->measure) {
+            race->attempts[i].ctx.TryCancel();
+        }
+    }
+
+    res = std::move(won.res);
+    return won.status;
+}
+
+bool OcrRpcClient::enableSharedMemory(uint32_t slots, size_t slotBytes, std::string& error) {
+    if (address_.rfind("unix:", 0) != 0) {
+        error = "shared memory needs a unix:<path> server address";
+        return false;
+    }
+
+    ring_ = ShmRing::create(slots, slotBytes, error);
+    if (!ring_) return false;
+
+    std::cerr << "[Client] Shared memory ring " << ring_->name() << ": "
+              << slots << " x " << (ring_->slotSize() >> 20) << " MB" << std::endl;
+    return true;
+}
+
+OcrRpcResult OcrRpcClient::recognize(
+    int64_t batchId,
+    int index,
+    const std::string& filename,
+    std::string imageData,
+    const std::string& contentSha256
+) {
+    OcrRpcResult cached;
+    if (hashFirst_) {
+        std::string digest = contentSha256.empty()
+            ? Sha256::toBytes(Sha256::hash(imageData)) : contentSha256;
+        if (lookupCached(batchId, index, filename, digest, cached)) return cached;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ShmRing::Lease slot;
+    ocr::OcrRequest req = makeRequest(batchId, index, filename, std::move(imageData), slot);
+
+    ocr::OcrResponse res;
+    grpc::Status status = call(std::move(req), res);
+
+    OcrRpcResult result;
+    result.roundTripUs = elapsedUs(start);
+    if (!status.ok()) {
+        result.filename = filename;
+        result.success = false;
+        result.error = status.error_message();
+    } else {
+        fromResponse(res, result);
+    }
+    result.uploaded = true;
+    return result;
+}
+
+OcrRpcResult OcrRpcClient::recognizeStream(
+    int64_t batchId,
+    int index,
+    const std::string& filename,
+    std::string imageData,
+    const std::function<void(const ocr::OcrPartial&)>& onPartial,
+    const std::string& contentSha256
+) {
+    // a cached result comes back whole, without partials
+    OcrRpcResult cached;
+    if (hashFirst_) {
+        std::string digest = contentSha256.empty()
+            ? Sha256::toBytes(Sha256::hash(imageData)) : contentSha256;
+        if (lookupCached(batchId, index, filename, digest, cached)) return cached;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ShmRing::Lease slot;
+    ocr::OcrRequest req = makeRequest(batchId, index, filename, std::move(imageData), slot);
+
+    grpc::ClientContext ctx;
+    std::unique_ptr<grpc::ClientReader<ocr::OcrStreamMessage>> reader =
+        stub_->RecognizeImageStream(&ctx, req);
+
+    OcrRpcResult result;
+    result.filename = filename;
+    result.uploaded = true;
+    bool gotSummary = false;
+
+    ocr::OcrStreamMessage msg;
+    while (reader->Read(&msg)) {
+        if (msg.has_partial()) {
+            if (onPartial) onPartial(msg.partial());
+        } else if (msg.has_summary()) {
+            fromResponse(msg.summary(), result);
+            gotSummary = true;
+        } else if (msg.has_queued()) {
+            result.expectedMs = msg.queued().expected_ms();
+        }
+    }
+
+    grpc::Status status = reader->Finish();
+    result.roundTripUs = elapsedUs(start);
+    if (!status.ok()) {
+        result.success = false;
+        result.error = status.error_message();
+    } else if (!gotSummary) {
+        result.success = false;
+        result.error = "stream ended without a result";
+    }
+    return result;
+}
+
+bool OcrRpcClient::setFaults(const std::string& spec, std::string& applied,
+                             std::string& error) {
+    ocr::FaultSpec req, res;
+    req.set_spec(spec);
+
+    grpc::ClientContext ctx;
+    grpc::Status status = stub_->SetFaults(&ctx, req, &res);
+    if (!status.ok()) {
+        error = status.error_message();
+        return false;
+    }
+    applied = res.spec();
+    return true;
+}
+
+bool OcrRpcClient::dumpTrace(ocr::TraceDump& out, std::string& error) {
+    grpc::ClientContext ctx;
+    grpc::Status status = stub_->DumpTrace(&ctx, ocr::TraceRequest(), &out);
+    if (!status.ok()) {
+        error = status.error_message();
+        return false;
+    }
+    return true;
+}
+
+bool OcrRpcClient::serverStats(ocr::ServerStats& out, std::string& error) {
+    grpc::ClientContext ctx;
+    grpc::Status status = stub_->GetServerStats(&ctx, ocr::StatsRequest(), &out);
+    if (!status.ok()) {
+        error = status.error_message();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+#include "ocr.grpc.pb.h"
+#include "RequestHedger.h"
+#include "ShmRing.h"
+
+// Server address configuration
+static constexpr const char* kDefaultServerAddress = "192.168.1.12:50051";
+
+// server-side stage times (StageTimings in ocr.proto), in microseconds
+// since the server received the request; 0 = stage not reached
+struct OcrStageTimes {
+    long long queuedUs = 0;
+    long long dequeuedUs = 0;
+    long long decodedUs = 0;
+    long long recognizedUs = 0;
+    long long delayDoneUs = 0;
+    long long completedUs = 0;
+    long long respondedUs = 0;
+    int workerId = -1;
+};
+
+// what came back for one image, whether the RPC itself worked or not
+struct OcrRpcResult {
+    std::string filename;
+    std::string text;
+    bool success = false;
+    std::string error;
+    long long ms = 0;
+    std::string modelTier;      // "fast", "standard" or "best"
+    int confidence = 0;
+    bool escalated = false;
+    bool cacheHit = false;      // served from the server's result cache
+    bool uploaded = false;      // the image bytes had to be sent
+    bool nearDuplicate = false; // text reused from a similar-looking image
+    long long expectedMs = 0;   // server's completion estimate when queued
+    OcrStageTimes timings;
+    long long roundTripUs = 0;  // call start to reply, as seen by the client
+};
+
+// Qt-free gRPC client shared by the GUI and the headless CLI.
+// recognize() blocks and may be called from many threads at once.
+class OcrRpcClient {
+public:
+    explicit OcrRpcClient(const std::string& address = kDefaultServerAddress);
+
+    // contentSha256: raw digest of imageData if the caller already has it;
+    // only used with setHashFirst(true), which computes it otherwise
+    OcrRpcResult recognize(
+        int64_t batchId,
+        int index,
+        const std::string& filename,
+        std::string imageData,
+        const std::string& contentSha256 = std::string()
+    );
+
+    // same, over RecognizeImageStream: onPartial gets each line (or block,
+    // per options().stream_level()) as soon as the server has it, on the
+    // calling thread, before the full result is returned
+    OcrRpcResult recognizeStream(
+        int64_t batchId,
+        int index,
+        const std::string& filename,
+        std::string imageData,
+        const std::function<void(const ocr::OcrPartial&)>& onPartial,
+        const std::string& contentSha256 = std::string()
+    );
+
+    // server-side counters (layout routing, engine pools, ...)
+    bool serverStats(ocr::ServerStats& out, std::string& error);
+
+    // replaces the server's injected latency / failures; applied is the
+    // spec the server now runs with
+    bool setFaults(const std::string& spec, std::string& applied, std::string& error);
+
+    // the server's recent request timeline (started with --trace-events)
+    bool dumpTrace(ocr::TraceDump& out, std::string& error);
+
+    // Passes image bytes through a shared-memory ring instead of the RPC.
+    // Only for a server on this host reached via "unix:<path>"; images that
+    // don't fit a slot, or arrive while all slots are busy, go inline.
+    bool enableSharedMemory(uint32_t slots, size_t slotBytes, std::string& error);
+
+    // Hash-first handshake: ask for a cached result by content hash, and
+    // only upload the bytes if the server doesn't have one. Saves the
+    // upload for images the server has seen, costs a round trip otherwise.
+    void setHashFirst(bool on) { hashFirst_ = on; }
+    bool hashFirst() const { return hashFirst_; }
+
+    // Hedged requests: a recognize() still unanswered after a percentile
+    // of recent latencies is sent again to the next of these servers, and
+    // whichever answers first wins; the other call is cancelled (except
+    // for a sample of slow primaries, left to finish so hedgeStats() can
+    // tell what hedging saved). Not used for recognizeStream() or for
+    // images passed through shared memory.
+    void enableHedging(const std::vector<std::string>& addresses, const HedgePolicy& policy);
+    bool hedging() const { return hedger_ != nullptr; }
+    HedgeStats hedgeStats() const;
+
+    // recognition settings sent with every later request
+    void setOptions(const ocr::OcrOptions& options) { options_ = options; }
+    const ocr::OcrOptions& options() const { return options_; }
+
+    const std::string& address() const { return address_; }
+
+private:
+    // slot holds the image while the request is in flight, if one was used
+    ocr::OcrRequest makeRequest(int64_t batchId, int index,
+                                const std::string& filename,
+                                std::string imageData,
+                                ShmRing::Lease& slot) const;
+
+    // hash-only request; true (result filled) on a cache hit
+    bool lookupCached(int64_t batchId, int index, const std::string& filename,
+                      const std::string& contentSha256, OcrRpcResult& result);
+
+    // RecognizeImage on the primary, hedged if enabled
+    grpc::Status call(ocr::OcrRequest req, ocr::OcrResponse& res);
+
+    std::string address_;
+    ocr::OcrOptions options_;
+    std::unique_ptr<ocr::OcrService::Stub> stub_;
+    std::unique_ptr<ShmRing> ring_;
+    bool hashFirst_ = false;
+    std::shared_ptr<RequestHedger> hedger_;     // outlives calls still in flight
+    std::vector<std::unique_ptr<ocr::OcrService::Stub>> hedgeStubs_;
+    std::atomic<size_t> nextHedge_{0};
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+#include <chrono>
+#include <cstddef>
+
+#include "MpscBuffer.h"
+
+// what an RPC thread has for the GUI: a streamed line, or the final result
+struct OcrUpdate {
+    bool partial = false;
+    qint64 batchId = 0;
+    int index = 0;
+    QString filename;
+    QString text;
+    bool success = false;
+    QString error;
+    qint64 ms = 0;
+};
+
+// share of a frame one GUI tick may spend applying updates
+static constexpr auto kUpdateTickBudget = std::chrono::milliseconds(8);
+static constexpr size_t kUpdatesPerChunk = 512;
+
+// Hands queued updates to apply, oldest first, until none are left or
+// kUpdateTickBudget has passed; the rest wait for the next tick, so a
+// burst of results is spread over frames instead of stalling one.
+// Returns how many were applied.
+template <typename F>
+size_t drainForOneTick(MpscBuffer<OcrUpdate>& updates, F&& apply) {
+    const auto deadline = std::chrono::steady_clock::now() + kUpdateTickBudget;
+    size_t total = 0;
+    size_t n;
+    do {
+        n = updates.drain(apply, kUpdatesPerChunk);
+        total += n;
+    } while (n == kUpdatesPerChunk && std::chrono::steady_clock::now() < deadline);
+    return total;
+}
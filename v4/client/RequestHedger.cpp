@@ -0,0 +1,112 @@
+#include "RequestHedger.h"
+
+#include <algorithm>
+
+// p in [0, 1]; sorts a copy of v
+static long long percentile(std::vector<long long> v, double p) {
+    if (v.empty()) return 0;
+    size_t i = static_cast<size_t>(p * (v.size() - 1) + 0.5);
+    i = std::min(i, v.size() - 1);
+    std::nth_element(v.begin(), v.begin() + i, v.end());
+    return v[i];
+}
+
+RequestHedger::RequestHedger(const HedgePolicy& policy)
+    : policy_(policy)
+{
+    policy_.percentile = std::clamp(policy_.percentile, 0.0, 1.0);
+    policy_.maxRate = std::clamp(policy_.maxRate, 0.0, 1.0);
+    policy_.minSamples = std::clamp(policy_.minSamples, 1, static_cast<int>(kWindow));
+
+    window_.reserve(kWindow);
+    observed_.reserve(kReport);
+    primary_.reserve(kReport);
+}
+
+long long RequestHedger::admit() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    requests_++;
+    tokens_ = std::min(tokens_ + policy_.maxRate, kBurst);
+    return delayUs_.load(std::memory_order_relaxed);
+}
+
+bool RequestHedger::tryHedge() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (tokens_ < 1) {
+        capped_++;
+        return false;
+    }
+    tokens_ -= 1;
+    hedged_++;
+    return true;
+}
+
+bool RequestHedger::hedgeWon() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (hedgeWins_++ % kMeasureEvery != 0 || tokens_ < 1) return false;
+    tokens_ -= 1;
+    measured_++;
+    return true;
+}
+
+void RequestHedger::record(long long observedUs, long long primaryUs) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    addLatency(primaryUs);
+    addReport(observedUs, primaryUs);
+}
+
+void RequestHedger::recordCut(long long primaryAtLeastUs) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    addLatency(primaryAtLeastUs);
+}
+
+void RequestHedger::recordMeasured(long long observedUs, long long primaryUs) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    addLatency(primaryUs);
+
+    // stands in for every won hedge, the cut ones included; fewer than one
+    // in kMeasureEvery are measured when the budget runs short
+    const long long weight = std::max(1LL, hedgeWins_ / std::max(1LL, measured_));
+    for (long long i = 0; i < weight; i++) addReport(observedUs, primaryUs);
+}
+
+// the delay follows the primary, not what hedging made of it; otherwise
+// every won hedge would pull it down and hedge more
+void RequestHedger::addLatency(long long primaryUs) {
+    if (window_.size() < kWindow) {
+        window_.push_back(primaryUs);
+    } else {
+        window_[windowNext_] = primaryUs;
+        windowNext_ = (windowNext_ + 1) % kWindow;
+    }
+
+    if (window_.size() < static_cast<size_t>(policy_.minSamples)) return;
+    if (++sinceRecompute_ < kRecompute && delayUs_.load(std::memory_order_relaxed) >= 0) return;
+    sinceRecompute_ = 0;
+    delayUs_.store(percentile(window_, policy_.percentile), std::memory_order_relaxed);
+}
+
+void RequestHedger::addReport(long long observedUs, long long primaryUs) {
+    if (observed_.size() < kReport) {
+        observed_.push_back(observedUs);
+        primary_.push_back(primaryUs);
+    } else {
+        observed_[reportNext_] = observedUs;
+        primary_[reportNext_] = primaryUs;
+        reportNext_ = (reportNext_ + 1) % kReport;
+    }
+}
+
+HedgeStats RequestHedger::stats() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    HedgeStats s;
+    s.requests = requests_;
+    s.hedged = hedged_;
+    s.hedgeWins = hedgeWins_;
+    s.capped = capped_;
+    s.measured = measured_;
+    s.delayUs = delayUs_.load(std::memory_order_relaxed);
+    s.p99Us = percentile(observed_, 0.99);
+    s.p99PrimaryUs = percentile(primary_, 0.99);
+    return s;
+}
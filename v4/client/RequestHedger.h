@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// when a slow request gets a duplicate on another server
+struct HedgePolicy {
+    double percentile = 0.95;   // hedge once a request is slower than this share of recent ones
+    double maxRate = 0.05;      // at most this share of requests is hedged
+    int minSamples = 20;        // no hedges until this many latencies are known
+};
+
+struct HedgeStats {
+    long long requests = 0;
+    long long hedged = 0;       // duplicates sent
+    long long hedgeWins = 0;    // duplicate answered first
+    long long capped = 0;       // slow enough to hedge, but over maxRate
+    long long measured = 0;     // primaries left running after their hedge
+                                // won; charged to maxRate like hedges
+    long long delayUs = -1;     // current wait before hedging; -1 = still learning
+    long long p99Us = 0;        // what callers saw
+    // the first server alone; won hedges are only measured on a sample
+    // (the rest are cancelled), so this is an estimate
+    long long p99PrimaryUs = 0;
+};
+
+// Hedge delay and budget for OcrRpcClient. The delay tracks a percentile
+// of recent primary latencies, so it follows the servers as they speed up
+// or slow down. The budget is a token bucket: each request earns maxRate
+// of a hedge, so a slowdown that pushes every request past the delay
+// still can't add more than maxRate extra load. A primary left running to
+// measure a won hedge is extra load too, and takes a token the same way.
+class RequestHedger {
+public:
+    explicit RequestHedger(const HedgePolicy& policy);
+
+    // once per request: earns its share of the budget, and returns how
+    // long to wait for the primary before hedging (-1 = don't)
+    long long admit();
+
+    // a hedge for a request that has waited admit()'s delay; false if
+    // the budget is spent
+    bool tryHedge();
+
+    // the hedge answered first; true if the primary should be left to
+    // finish (not cancelled) so the time hedging saved can be measured.
+    // one win in kMeasureEvery, and only while the budget has a token
+    bool hedgeWon();
+
+    // a request whose primary answered; observedUs is what the caller saw
+    void record(long long observedUs, long long primaryUs);
+
+    // a primary cancelled after primaryAtLeastUs, when its hedge won
+    void recordCut(long long primaryAtLeastUs);
+
+    // a primary left running by hedgeWon(); stands in for the cut ones
+    void recordMeasured(long long observedUs, long long primaryUs);
+
+    HedgeStats stats() const;
+    const HedgePolicy& policy() const { return policy_; }
+
+private:
+    static constexpr size_t kWindow = 512;      // latencies the delay comes from
+    static constexpr size_t kRecompute = 16;    // records between delay updates
+    static constexpr size_t kReport = 8192;     // requests the p99s cover
+    static constexpr double kBurst = 4;         // hedges saved up at most
+    static constexpr int kMeasureEvery = 4;     // won hedges per measured primary
+
+    void addLatency(long long primaryUs);
+    void addReport(long long observedUs, long long primaryUs);
+
+    HedgePolicy policy_;
+    std::atomic<long long> delayUs_{-1};
+
+    mutable std::mutex mtx_;
+    std::vector<long long> window_;
+    size_t windowNext_ = 0;
+    size_t sinceRecompute_ = 0;
+    std::vector<long long> observed_;
+    std::vector<long long> primary_;
+    size_t reportNext_ = 0;
+    double tokens_ = 0;
+    long long requests_ = 0;
+    long long hedged_ = 0;
+    long long hedgeWins_ = 0;
+    long long capped_ = 0;
+    long long measured_ = 0;
+};
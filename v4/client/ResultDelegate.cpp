@@ -0,0 +1,39 @@
+#include "ResultDelegate.h"
+#include "ResultsModel.h"
+
+#include <QPainter>
+#include <QPixmap>
+
+void ResultDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option,
+                           const QModelIndex& index) const {
+    painter->save();
+    painter->setClipRect(option.rect);
+
+    QRect card = option.rect.adjusted(2, 2, -2, -2);
+    QRect imgArea(card.left(), card.top(), card.width(), card.height() / 2);
+    QRect textArea(card.left(), imgArea.bottom() + 2,
+                   card.width(), card.bottom() - imgArea.bottom() - 2);
+
+    // asking for the preview is what triggers its decode
+    QPixmap thumb = index.data(ResultsModel::ThumbnailRole).value<QPixmap>();
+    if (!thumb.isNull()) {
+        QSize size = thumb.size().scaled(thumbnailSize(), Qt::KeepAspectRatio)
+                                 .boundedTo(thumb.size());
+        QRect target(QPoint(0, 0), size);
+        target.moveCenter(imgArea.center());
+        painter->drawPixmap(target, thumb);
+    }
+
+    QFont font = option.font;
+    font.setPixelSize(13);
+    painter->setFont(font);
+    painter->setPen(Qt::white);
+    painter->drawText(textArea, Qt::AlignHCenter | Qt::AlignTop | Qt::TextWordWrap,
+                      index.data(Qt::DisplayRole).toString());
+
+    painter->restore();
+}
+
+QSize ResultDelegate::sizeHint(const QStyleOptionViewItem&, const QModelIndex&) const {
+    return cardSize();
+}
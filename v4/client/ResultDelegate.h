@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QStyledItemDelegate>
+
+// paints one OCR card (preview + text) straight from the model, so the
+// grid needs no widget per image
+class ResultDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+
+    static QSize cardSize() { return QSize(210, 140); }
+    static QSize thumbnailSize() { return QSize(180, 45); }
+
+    void paint(QPainter* painter, const QStyleOptionViewItem& option,
+               const QModelIndex& index) const override;
+    QSize sizeHint(const QStyleOptionViewItem& option,
+                   const QModelIndex& index) const override;
+};
@@ -0,0 +1,295 @@
+#include "ResultExport.h"
+#include "JsonString.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+std::string lowercase(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+std::string toJsonLine(int index, const std::string& path, const OcrRpcResult& r) {
+    std::string line;
+    line.reserve(128 + path.size() + r.text.size());
+    line += "{\"index\":";
+    line += std::to_string(index);
+    line += ",\"path\":";
+    appendJsonString(line, path);
+    line += ",\"success\":";
+    line += r.success ? "true" : "false";
+    line += ",\"text\":";
+    appendJsonString(line, r.text);
+    line += ",\"error\":";
+    appendJsonString(line, r.error);
+    line += ",\"ms\":";
+    line += std::to_string(r.ms);
+    line += ",\"tier\":";
+    appendJsonString(line, r.modelTier);
+    line += ",\"confidence\":";
+    line += std::to_string(r.confidence);
+    line += ",\"escalated\":";
+    line += r.escalated ? "true" : "false";
+    line += "}\n";
+    return line;
+}
+
+std::string toPartialJsonLine(int index, int sequence, const std::string& text, int confidence) {
+    std::string line;
+    line.reserve(64 + text.size());
+    line += "{\"index\":";
+    line += std::to_string(index);
+    line += ",\"partial\":true,\"seq\":";
+    line += std::to_string(sequence);
+    line += ",\"text\":";
+    appendJsonString(line, text);
+    line += ",\"confidence\":";
+    line += std::to_string(confidence);
+    line += "}\n";
+    return line;
+}
+
+// quoted only when it has to be, doubling inner quotes (RFC 4180)
+void appendCsvField(std::string& out, const std::string& s) {
+    if (s.find_first_of(",\"\r\n") == std::string::npos) {
+        out += s;
+        return;
+    }
+    out += '"';
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+std::string toCsvLine(int index, const std::string& path, const OcrRpcResult& r) {
+    std::string line;
+    line.reserve(64 + path.size() + r.text.size());
+    line += std::to_string(index);
+    line += ',';
+    appendCsvField(line, path);
+    line += r.success ? ",true," : ",false,";
+    appendCsvField(line, r.text);
+    line += ',';
+    appendCsvField(line, r.error);
+    line += ',';
+    line += std::to_string(r.ms);
+    line += ',';
+    line += r.modelTier;
+    line += ',';
+    line += std::to_string(r.confidence);
+    line += r.escalated ? ",true\r\n" : ",false\r\n";
+    return line;
+}
+
+const char kCsvHeader[] = "index,path,success,text,error,ms,tier,confidence,escalated\r\n";
+const char kColumnarMagic[] = "OCRCOL1\n";
+
+template <typename T>
+void putRaw(std::string& out, const T& v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+void putColumn(std::string& out, const std::vector<T>& col) {
+    out.append(reinterpret_cast<const char*>(col.data()), col.size() * sizeof(T));
+}
+
+void putStringColumn(std::string& out, const std::vector<std::string>& col) {
+    uint32_t offset = 0;
+    putRaw(out, offset);
+    for (const std::string& s : col) {
+        offset += static_cast<uint32_t>(s.size());
+        putRaw(out, offset);
+    }
+    for (const std::string& s : col) out += s;
+}
+
+} // namespace
+
+bool parseExportFormat(const std::string& name, ExportFormat& out) {
+    std::string n = lowercase(name);
+    if (n == "jsonl")    { out = ExportFormat::Jsonl; return true; }
+    if (n == "csv")      { out = ExportFormat::Csv; return true; }
+    if (n == "columnar") { out = ExportFormat::Columnar; return true; }
+    return false;
+}
+
+ExportFormat exportFormatForPath(const std::string& path) {
+    std::string p = lowercase(path);
+    auto endsWith = [&](const char* ext) {
+        size_t n = std::strlen(ext);
+        return p.size() >= n && p.compare(p.size() - n, n, ext) == 0;
+    };
+    if (endsWith(".csv"))  return ExportFormat::Csv;
+    if (endsWith(".ocrc")) return ExportFormat::Columnar;
+    return ExportFormat::Jsonl;
+}
+
+void ResultExporter::ColumnBlock::clear() {
+    index.clear(); success.clear(); escalated.clear();
+    ms.clear(); confidence.clear();
+    path.clear(); text.clear(); error.clear(); tier.clear();
+}
+
+std::unique_ptr<ResultExporter> ResultExporter::open(const std::string& path,
+                                                     ExportFormat format,
+                                                     std::string& error) {
+    FILE* file = stdout;
+    bool owns = false;
+    if (path != "-") {
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            error = path + ": " + std::strerror(errno);
+            return nullptr;
+        }
+        owns = true;
+    }
+    return std::unique_ptr<ResultExporter>(new ResultExporter(file, owns, format));
+}
+
+ResultExporter::ResultExporter(FILE* file, bool ownsFile, ExportFormat format)
+    : file_(file), ownsFile_(ownsFile), format_(format)
+{
+    if (format_ == ExportFormat::Csv) pending_ = kCsvHeader;
+    if (format_ == ExportFormat::Columnar) pending_.assign(kColumnarMagic, 8);
+
+    writer_ = std::thread(&ResultExporter::writerLoop, this);
+}
+
+ResultExporter::~ResultExporter() {
+    std::string ignored;
+    close(ignored);
+}
+
+long long ResultExporter::records() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return records_;
+}
+
+void ResultExporter::write(int index, const std::string& path, const OcrRpcResult& result) {
+    // encode outside the lock; only the columnar block is shared state
+    std::string line;
+    if (format_ == ExportFormat::Jsonl) line = toJsonLine(index, path, result);
+    if (format_ == ExportFormat::Csv)   line = toCsvLine(index, path, result);
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (closing_) return;
+    records_++;
+
+    if (format_ != ExportFormat::Columnar) {
+        appendLocked(line, lock);
+        return;
+    }
+
+    block_.index.push_back(index);
+    block_.success.push_back(result.success ? 1 : 0);
+    block_.escalated.push_back(result.escalated ? 1 : 0);
+    block_.ms.push_back(result.ms);
+    block_.confidence.push_back(result.confidence);
+    block_.path.push_back(path);
+    block_.text.push_back(result.text);
+    block_.error.push_back(result.error);
+    block_.tier.push_back(result.modelTier);
+
+    if (block_.rows() >= kColumnarBlockRows) encodeBlockLocked(lock);
+}
+
+void ResultExporter::writePartial(int index, int sequence, const std::string& text, int confidence) {
+    if (format_ != ExportFormat::Jsonl) return;
+
+    std::string line = toPartialJsonLine(index, sequence, text, confidence);
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (closing_) return;
+    appendLocked(line, lock);
+}
+
+// caller holds the lock; waits while the writer is too far behind
+void ResultExporter::appendLocked(const std::string& bytes, std::unique_lock<std::mutex>& lock) {
+    spaceFree_.wait(lock, [&]{ return pending_.size() < kMaxPendingBytes || failed_; });
+    if (failed_) return;
+
+    pending_ += bytes;
+    if (pending_.size() >= kFlushBytes) dataReady_.notify_one();
+}
+
+void ResultExporter::encodeBlockLocked(std::unique_lock<std::mutex>& lock) {
+    if (block_.rows() == 0) return;
+
+    std::string out;
+    putRaw(out, static_cast<uint32_t>(block_.rows()));
+    putColumn(out, block_.index);
+    putColumn(out, block_.success);
+    putColumn(out, block_.escalated);
+    putColumn(out, block_.ms);
+    putColumn(out, block_.confidence);
+    putStringColumn(out, block_.path);
+    putStringColumn(out, block_.text);
+    putStringColumn(out, block_.error);
+    putStringColumn(out, block_.tier);
+    block_.clear();
+
+    appendLocked(out, lock);
+}
+
+bool ResultExporter::close(std::string& error) {
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (!closing_) {
+            if (format_ == ExportFormat::Columnar) {
+                encodeBlockLocked(lock);
+                std::string end;
+                putRaw(end, static_cast<uint32_t>(0));
+                appendLocked(end, lock);
+            }
+            closing_ = true;
+            dataReady_.notify_one();
+        }
+    }
+
+    if (writer_.joinable()) {
+        writer_.join();
+        if (ownsFile_ && std::fclose(file_) != 0) failed_ = true;
+        else if (!ownsFile_) std::fflush(file_);
+    }
+
+    if (failed_) error = "write failed";
+    return !failed_;
+}
+
+// Writes in chunks of at least kFlushBytes, or whatever is there every
+// 200 ms, so a slow trickle of results still reaches the file promptly.
+void ResultExporter::writerLoop() {
+    std::string out;
+    for (;;) {
+        bool done;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            dataReady_.wait_for(lock, std::chrono::milliseconds(200), [&]{
+                return closing_ || pending_.size() >= kFlushBytes;
+            });
+            out.swap(pending_);
+            done = closing_;
+        }
+        spaceFree_.notify_all();
+
+        if (!out.empty()) {
+            bool ok = std::fwrite(out.data(), 1, out.size(), file_) == out.size() &&
+                      std::fflush(file_) == 0;
+            if (!ok) {
+                std::lock_guard<std::mutex> lock(mtx_);
+                failed_ = true;
+                spaceFree_.notify_all();
+            }
+            out.clear();
+        }
+        if (done) return;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "OcrRpcClient.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams results to a file as they arrive, so nothing has to be kept in
+// memory until the batch ends. Qt-free; used by both ocr_cli and the GUI.
+//
+//   jsonl     one JSON object per line
+//   csv       RFC 4180, with a header row
+//   columnar  little-endian binary, in blocks of up to 4096 rows:
+//               "OCRCOL1\n"
+//               per block: u32 rows, then one column at a time:
+//                 index i32[rows], success u8[rows], escalated u8[rows],
+//                 ms i64[rows], confidence i32[rows],
+//                 path, text, error, tier: u32 offsets[rows + 1] + bytes
+//               u32 0 after the last block
+
+enum class ExportFormat { Jsonl, Csv, Columnar };
+
+bool parseExportFormat(const std::string& name, ExportFormat& out);
+
+// by extension: .csv, .ocrc (columnar), anything else JSONL
+ExportFormat exportFormatForPath(const std::string& path);
+
+class ResultExporter {
+public:
+    // path "-" = stdout
+    static std::unique_ptr<ResultExporter> open(const std::string& path,
+                                                ExportFormat format,
+                                                std::string& error);
+    ~ResultExporter();
+
+    ResultExporter(const ResultExporter&) = delete;
+    ResultExporter& operator=(const ResultExporter&) = delete;
+
+    // Thread-safe. Encodes into a buffer that a background thread writes
+    // out; only blocks if the disk falls kMaxPendingBytes behind.
+    void write(int index, const std::string& path, const OcrRpcResult& result);
+
+    // a streamed line ahead of the final result; JSONL only, else ignored
+    void writePartial(int index, int sequence, const std::string& text, int confidence);
+
+    // flushes everything and closes the file; false if any write failed
+    bool close(std::string& error);
+
+    ExportFormat format() const { return format_; }
+    long long records() const;
+
+private:
+    static constexpr size_t kFlushBytes = 64 << 10;
+    static constexpr size_t kMaxPendingBytes = 16 << 20;
+    static constexpr size_t kColumnarBlockRows = 4096;
+
+    struct ColumnBlock {
+        std::vector<int32_t> index;
+        std::vector<uint8_t> success;
+        std::vector<uint8_t> escalated;
+        std::vector<int64_t> ms;
+        std::vector<int32_t> confidence;
+        std::vector<std::string> path, text, error, tier;
+
+        size_t rows() const { return index.size(); }
+        void clear();
+    };
+
+    ResultExporter(FILE* file, bool ownsFile, ExportFormat format);
+
+    void appendLocked(const std::string& bytes, std::unique_lock<std::mutex>& lock);
+    void encodeBlockLocked(std::unique_lock<std::mutex>& lock);
+    void writerLoop();
+
+    FILE* file_;
+    bool ownsFile_;
+    ExportFormat format_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable dataReady_;
+    std::condition_variable spaceFree_;
+    std::string pending_;
+    ColumnBlock block_;
+    long long records_ = 0;
+    bool closing_ = false;
+    bool failed_ = false;
+
+    std::thread writer_;
+};
@@ -0,0 +1,123 @@
+#include "ResultsModel.h"
+#include "ThumbnailLoader.h"
+
+#include <QFileInfo>
+
+ResultsModel::ResultsModel(ThumbnailLoader* loader, QObject* parent)
+    : QAbstractListModel(parent),
+      loader_(loader),
+      thumbnails_(kMaxThumbnails)
+{}
+
+int ResultsModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : entries_.size();
+}
+
+QVariant ResultsModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= entries_.size()) return QVariant();
+
+    int row = index.row();
+    const Entry& e = entries_[row];
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return e.text;
+
+    case FileNameRole:
+        return QFileInfo(e.path).fileName();
+
+    case ThumbnailRole:
+        if (QPixmap* pix = thumbnails_.object(row)) return *pix;
+
+        // only rows a view paints get here, which is what keeps decoding
+        // proportional to the viewport
+        if (!pending_.contains(row)) {
+            pending_.insert(row);
+            loader_->load(batchId_, row, e.path);
+        }
+        return QVariant();
+
+    default:
+        return QVariant();
+    }
+}
+
+int ResultsModel::addFiles(qint64 batchId, const QStringList& paths) {
+    if (batchId != batchId_) clear();
+    batchId_ = batchId;
+
+    int first = entries_.size();
+    if (paths.isEmpty()) return first;
+
+    beginInsertRows(QModelIndex(), first, first + paths.size() - 1);
+    entries_.reserve(first + paths.size());
+    for (const QString& path : paths) {
+        Entry e;
+        e.path = path;
+        e.text = "In progress...";
+        entries_.push_back(std::move(e));
+    }
+    endInsertRows();
+    return first;
+}
+
+void ResultsModel::clear() {
+    beginResetModel();
+    entries_.clear();
+    entries_.squeeze();
+    dirtyFirst_ = dirtyLast_ = -1;
+    thumbnails_.clear();
+    pending_.clear();
+    endResetModel();
+}
+
+void ResultsModel::appendPartial(int row, const QString& text) {
+    if (row < 0 || row >= entries_.size()) return;
+
+    Entry& e = entries_[row];
+    if (!e.streaming) {
+        e.text.clear();
+        e.streaming = true;
+    }
+    if (!e.text.isEmpty()) e.text += '\n';
+    e.text += text.trimmed();
+    markDirty(row);
+}
+
+void ResultsModel::setResult(int row, const QString& text) {
+    if (row < 0 || row >= entries_.size()) return;
+
+    Entry& e = entries_[row];
+    e.text = text;
+    e.streaming = false;
+    markDirty(row);
+}
+
+void ResultsModel::markDirty(int row) {
+    if (dirtyFirst_ < 0 || row < dirtyFirst_) dirtyFirst_ = row;
+    if (row > dirtyLast_) dirtyLast_ = row;
+}
+
+void ResultsModel::flushChanges() {
+    if (dirtyFirst_ < 0) return;
+
+    // one range covering every changed row; the view only repaints the
+    // part of it that is visible
+    emit dataChanged(index(dirtyFirst_), index(dirtyLast_), {Qt::DisplayRole});
+    dirtyFirst_ = dirtyLast_ = -1;
+}
+
+void ResultsModel::forgetPendingThumbnails() {
+    pending_.clear();
+}
+
+void ResultsModel::setThumbnail(qint64 batchId, int row, const QImage& thumbnail) {
+    if (batchId != batchId_ || row < 0 || row >= entries_.size()) return;
+    pending_.remove(row);
+
+    // a failed decode is cached too (as a null pixmap) so it isn't retried
+    thumbnails_.insert(row, new QPixmap(QPixmap::fromImage(thumbnail)));
+
+    QModelIndex idx = index(row);
+    emit dataChanged(idx, idx, {ThumbnailRole});
+}
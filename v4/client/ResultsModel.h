@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QCache>
+#include <QPixmap>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+class ThumbnailLoader;
+
+// One row per uploaded image. Rows only hold the path and the text; the
+// previews of rows a view actually asks for are decoded on demand and kept
+// in a bounded cache, so memory doesn't grow with the batch.
+class ResultsModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    enum Roles {
+        ThumbnailRole = Qt::UserRole + 1,   // QPixmap, null until decoded
+        FileNameRole,
+    };
+
+    explicit ResultsModel(ThumbnailLoader* loader, QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role) const override;
+
+    // appends a row per path; returns the first new row
+    int addFiles(qint64 batchId, const QStringList& paths);
+    void clear();
+
+    // text changes are collected and announced together by flushChanges(),
+    // so a burst of results costs one repaint
+    void appendPartial(int row, const QString& text);
+    void setResult(int row, const QString& text);
+    void flushChanges();
+
+    // previews in flight are asked for again when next painted; used
+    // after ThumbnailLoader::cancelPending()
+    void forgetPendingThumbnails();
+
+public slots:
+    void setThumbnail(qint64 batchId, int row, const QImage& thumbnail);
+
+private:
+    static constexpr int kMaxThumbnails = 1024;
+
+    struct Entry {
+        QString path;
+        QString text;
+        bool streaming = false;     // text holds partial lines so far
+    };
+
+    ThumbnailLoader* loader_;
+    qint64 batchId_ = 0;
+    QVector<Entry> entries_;
+    int dirtyFirst_ = -1;       // rows with unannounced text changes
+    int dirtyLast_ = -1;
+
+    void markDirty(int row);
+
+    // filled lazily from data(), hence mutable; evicted rows are decoded
+    // again if they scroll back into view
+    mutable QCache<int, QPixmap> thumbnails_;
+    mutable QSet<int> pending_;
+};
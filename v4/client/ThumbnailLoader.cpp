@@ -0,0 +1,34 @@
+#include "ThumbnailLoader.h"
+
+#include <QImageReader>
+
+ThumbnailLoader::ThumbnailLoader(QSize thumbSize, QObject* parent)
+    : QObject(parent),
+      thumbSize_(thumbSize)
+{}
+
+ThumbnailLoader::~ThumbnailLoader() {
+    // running tasks emit on this object
+    pool_.clear();
+    pool_.waitForDone();
+}
+
+void ThumbnailLoader::load(qint64 batchId, int index, const QString& path) {
+    pool_.start([=, this]() {
+        QImageReader reader(path);
+        reader.setAutoTransform(true);
+
+        // formats that can (JPEG) decode at reduced size; the rest are
+        // scaled by the reader, still on this thread
+        QSize full = reader.size();
+        if (full.isValid()) {
+            reader.setScaledSize(full.scaled(thumbSize_, Qt::KeepAspectRatio));
+        }
+
+        emit thumbnailReady(batchId, index, reader.read());
+    });
+}
+
+void ThumbnailLoader::cancelPending() {
+    pool_.clear();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QImage>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+
+// Decodes previews on a background pool straight at card size, so the GUI
+// thread never touches full-resolution pixels. Results come back through
+// thumbnailReady.
+class ThumbnailLoader : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ThumbnailLoader(QSize thumbSize, QObject* parent = nullptr);
+    ~ThumbnailLoader() override;
+
+    void load(qint64 batchId, int index, const QString& path);
+
+    // drops previews not started yet, e.g. rows scrolled out of view
+    void cancelPending();
+
+signals:
+    // null thumbnail: unreadable file or not an image
+    void thumbnailReady(qint64 batchId, int index, QImage thumbnail);
+
+private:
+    QSize thumbSize_;
+    QThreadPool pool_;
+};
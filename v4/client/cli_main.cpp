@@ -0,0 +1,626 @@
+// Headless batch client: streams images to the server and writes each
+// result out as soon as it arrives (JSONL by default, or CSV / columnar).
+//
+//   ocr_cli [options] <directory>      walk a directory (recursively with -r)
+//   find scans -name '*.png' | ocr_cli [options] -
+//                                      read one path per line from stdin
+//
+// options:
+//   --server host:port   server address (default: kDefaultServerAddress),
+//                        or unix:PATH for a server on this host
+//   --shm                with unix:PATH, pass images through shared memory
+//   --shm-slot-mb N      largest image sent through shared memory (default: 16)
+//   -j, --concurrency N  images in flight at once (default: 8)
+//   -o, --output FILE    write results to FILE instead of stdout
+//   --format FMT         jsonl, csv or columnar (default: from -o's extension,
+//                        .csv / .ocrc, else jsonl)
+//   -r, --recursive      descend into sub-directories
+//   --batch-id N         batch id sent with every request (default: 1)
+//   --profile NAME       server profile: default, block, line, word, sparse
+//   --psm MODE           pin page segmentation: auto, block, line, word, sparse, raw-line
+//   --oem MODE           engine mode: lstm, legacy, combined
+//   --lang LANG          Tesseract language, e.g. eng or deu+eng
+//   --whitelist CHARS    only recognize these characters
+//   --tier TIER          model tier: fast, standard, best (default: server decides)
+//   --stream             also write a {"partial":true,...} line per recognized
+//                        line as it arrives, before the image's final line
+//                        (jsonl only)
+//   --stream-blocks      same, one partial per text block instead of per line
+//   --hash-first         send each image's SHA-256 first and upload the bytes
+//                        only if the server has no cached result for it
+//   --timings            print where each image's time went (queue, decode,
+//                        recognize, network, ...) at the end of the run
+//   --hedge ADDR[,ADDR]  resend an image to the next of these servers when
+//                        --server is slower than usual with it; the first
+//                        answer wins (not with --stream)
+//   --hedge-percentile P hedge once an image has taken longer than P% of
+//                        recent ones (default: 95)
+//   --hedge-max-rate P   hedge at most P% of images (default: 5)
+//   --server-stats       print the server's counters as JSON and exit
+//   --set-faults SPEC    change the server's injected latency / failures
+//                        (server needs --allow-fault-rpc; "off" clears)
+//   --dump-trace FILE    write the server's recent request timeline (Chrome
+//                        trace JSON, for ui.perfetto.dev) to FILE and exit
+//
+// Paths are produced lazily and handed to the workers through a bounded
+// queue, so memory stays flat however many files there are.
+
+#include "OcrRpcClient.h"
+#include "ResultExport.h"
+#include "Sha256.h"
+
+#include <google/protobuf/util/json_util.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct CliOptions {
+    std::string server = kDefaultServerAddress;
+    int concurrency = 8;
+    std::string output;        // empty = stdout
+    std::string format;        // empty = from output's extension
+    std::string input;         // directory, or "-" for stdin
+    bool recursive = false;
+    long long batchId = 1;
+    ocr::OcrOptions ocr;
+    bool serverStats = false;
+    std::string dumpTrace;     // file for --dump-trace
+    std::optional<std::string> setFaults;
+    bool stream = false;
+    bool hashFirst = false;
+    bool timings = false;
+    std::vector<std::string> hedge;     // servers for --hedge
+    HedgePolicy hedgePolicy;
+    bool sharedMemory = false;
+    size_t shmSlotMb = 16;
+};
+
+struct PathItem {
+    int index;
+    std::string path;
+};
+
+// a file read (and hashed, with --hash-first) ahead of its RPC
+struct LoadedItem {
+    int index;
+    std::string path;
+    bool readOk = false;
+    std::string data;
+    std::string sha256;     // raw digest; empty without --hash-first
+};
+
+// producer blocks while the queue is full
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        notFull_.wait(lock, [&]{ return queue_.size() < capacity_; });
+        queue_.push(std::move(item));
+        notEmpty_.notify_one();
+    }
+
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        notEmpty_.wait(lock, [&]{ return !queue_.empty() || closed_; });
+        if (queue_.empty()) return std::nullopt;
+
+        T item = std::move(queue_.front());
+        queue_.pop();
+        notFull_.notify_one();
+        return item;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        closed_ = true;
+        notEmpty_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    std::queue<T> queue_;
+    std::mutex mtx_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    bool closed_ = false;
+};
+
+// Per-stage latency across the run, from the server's stage timestamps
+// and the client's round trip. Only images that went through a worker
+// count; cache hits and coalesced requests have no stages.
+class StageTimings {
+public:
+    void add(const OcrRpcResult& res) {
+        const OcrStageTimes& t = res.timings;
+        if (t.dequeuedUs <= 0) return;
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        samples_[Scheduling].push_back(t.queuedUs);
+        samples_[QueueWait].push_back(t.dequeuedUs - t.queuedUs);
+        samples_[Decode].push_back(t.decodedUs - t.dequeuedUs);
+        samples_[Recognize].push_back(t.recognizedUs - t.decodedUs);
+        samples_[Injected].push_back(t.delayDoneUs - t.recognizedUs);
+        samples_[Handoff].push_back(t.completedUs - t.delayDoneUs);
+        samples_[Respond].push_back(t.respondedUs - t.completedUs);
+        samples_[Network].push_back(res.roundTripUs - t.respondedUs);
+        perWorker_[t.workerId]++;
+    }
+
+    void print() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (samples_[Scheduling].empty()) {
+            std::cerr << "[CLI] No stage timings (all results were cached?)" << std::endl;
+            return;
+        }
+
+        std::cerr << "[CLI] Stage timings over " << samples_[Scheduling].size()
+                  << " images (ms: mean / p50 / p95 / max)" << std::endl;
+        for (int s = 0; s < kStages; s++) {
+            std::vector<long long>& v = samples_[s];
+            std::sort(v.begin(), v.end());
+            long long sum = 0;
+            for (long long us : v) sum += us;
+
+            char line[128];
+            std::snprintf(line, sizeof(line), "[CLI]   %-11s %9.2f %9.2f %9.2f %9.2f",
+                          kNames[s], sum / 1000.0 / v.size(),
+                          percentile(v, 0.50) / 1000.0, percentile(v, 0.95) / 1000.0,
+                          v.back() / 1000.0);
+            std::cerr << line << std::endl;
+        }
+
+        std::cerr << "[CLI] Images per worker:";
+        for (const auto& [worker, count] : perWorker_) {
+            std::cerr << " " << worker << "=" << count;
+        }
+        std::cerr << std::endl;
+    }
+
+private:
+    enum Stage { Scheduling, QueueWait, Decode, Recognize, Injected, Handoff,
+                 Respond, Network, kStages };
+    static constexpr const char* kNames[kStages] = {
+        "scheduling", "queue wait", "decode", "recognize", "injected",
+        "handoff", "respond", "network"
+    };
+
+    // v sorted
+    static long long percentile(const std::vector<long long>& v, double p) {
+        size_t i = static_cast<size_t>(p * (v.size() - 1) + 0.5);
+        return v[std::min(i, v.size() - 1)];
+    }
+
+    std::mutex mtx_;
+    std::vector<long long> samples_[kStages];
+    std::map<int, int> perWorker_;
+};
+
+void printUsage() {
+    std::cerr <<
+        "usage: ocr_cli [--server host:port | --server unix:PATH [--shm] [--shm-slot-mb N]]\n"
+        "               [-j N] [-o FILE] [--format jsonl|csv|columnar] [-r] [--batch-id N]\n"
+        "               [--profile NAME] [--psm MODE] [--oem MODE] [--lang LANG]\n"
+        "               [--whitelist CHARS] [--tier TIER] [--stream | --stream-blocks]\n"
+        "               [--hash-first] [--timings]\n"
+        "               [--hedge ADDR[,ADDR...] [--hedge-percentile P] [--hedge-max-rate P]]\n"
+        "               <dir | ->\n"
+        "       ocr_cli [--server host:port] --server-stats\n"
+        "       ocr_cli [--server host:port] --dump-trace FILE\n"
+        "       ocr_cli [--server host:port] --set-faults SPEC\n";
+}
+
+bool parsePageSegMode(const std::string& s, ocr::PageSegMode& out) {
+    if (s == "auto")     { out = ocr::PAGE_SEG_AUTO; return true; }
+    if (s == "block")    { out = ocr::PAGE_SEG_SINGLE_BLOCK; return true; }
+    if (s == "line")     { out = ocr::PAGE_SEG_SINGLE_LINE; return true; }
+    if (s == "word")     { out = ocr::PAGE_SEG_SINGLE_WORD; return true; }
+    if (s == "sparse")   { out = ocr::PAGE_SEG_SPARSE_TEXT; return true; }
+    if (s == "raw-line") { out = ocr::PAGE_SEG_RAW_LINE; return true; }
+    return false;
+}
+
+bool parseEngineMode(const std::string& s, ocr::EngineMode& out) {
+    if (s == "lstm")     { out = ocr::ENGINE_LSTM_ONLY; return true; }
+    if (s == "legacy")   { out = ocr::ENGINE_LEGACY_ONLY; return true; }
+    if (s == "combined") { out = ocr::ENGINE_LEGACY_LSTM; return true; }
+    return false;
+}
+
+bool parseArgs(int argc, char** argv, CliOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* {
+            return (i + 1 < argc) ? argv[++i] : nullptr;
+        };
+
+        if (arg == "--server") {
+            const char* v = next(); if (!v) return false;
+            opt.server = v;
+        } else if (arg == "--hash-first") {
+            opt.hashFirst = true;
+        } else if (arg == "--timings") {
+            opt.timings = true;
+        } else if (arg == "--hedge") {
+            const char* v = next(); if (!v) return false;
+            std::stringstream ss(v);
+            std::string address;
+            while (std::getline(ss, address, ',')) {
+                if (!address.empty()) opt.hedge.push_back(address);
+            }
+            if (opt.hedge.empty()) return false;
+        } else if (arg == "--hedge-percentile") {
+            const char* v = next(); if (!v) return false;
+            double p = std::atof(v);
+            if (p <= 0 || p >= 100) return false;
+            opt.hedgePolicy.percentile = p / 100;
+        } else if (arg == "--hedge-max-rate") {
+            const char* v = next(); if (!v) return false;
+            double p = std::atof(v);
+            if (p < 0 || p > 100) return false;
+            opt.hedgePolicy.maxRate = p / 100;
+        } else if (arg == "--shm") {
+            opt.sharedMemory = true;
+        } else if (arg == "--shm-slot-mb") {
+            const char* v = next(); if (!v) return false;
+            opt.shmSlotMb = static_cast<size_t>(std::max(1, std::atoi(v)));
+        } else if (arg == "-j" || arg == "--concurrency") {
+            const char* v = next(); if (!v) return false;
+            opt.concurrency = std::max(1, std::atoi(v));
+        } else if (arg == "-o" || arg == "--output") {
+            const char* v = next(); if (!v) return false;
+            opt.output = v;
+        } else if (arg == "--format") {
+            const char* v = next(); if (!v) return false;
+            opt.format = v;
+        } else if (arg == "-r" || arg == "--recursive") {
+            opt.recursive = true;
+        } else if (arg == "--batch-id") {
+            const char* v = next(); if (!v) return false;
+            opt.batchId = std::atoll(v);
+        } else if (arg == "--profile") {
+            const char* v = next(); if (!v) return false;
+            opt.ocr.set_profile(v);
+        } else if (arg == "--psm") {
+            const char* v = next(); if (!v) return false;
+            ocr::PageSegMode mode;
+            if (!parsePageSegMode(v, mode)) return false;
+            opt.ocr.set_page_seg_mode(mode);
+        } else if (arg == "--oem") {
+            const char* v = next(); if (!v) return false;
+            ocr::EngineMode mode;
+            if (!parseEngineMode(v, mode)) return false;
+            opt.ocr.set_engine_mode(mode);
+        } else if (arg == "--lang") {
+            const char* v = next(); if (!v) return false;
+            opt.ocr.set_language(v);
+        } else if (arg == "--whitelist") {
+            const char* v = next(); if (!v) return false;
+            opt.ocr.set_char_whitelist(v);
+        } else if (arg == "--tier") {
+            const char* v = next(); if (!v) return false;
+            std::string t = v;
+            if (t == "fast")          opt.ocr.set_model_tier(ocr::MODEL_TIER_FAST);
+            else if (t == "standard") opt.ocr.set_model_tier(ocr::MODEL_TIER_STANDARD);
+            else if (t == "best")     opt.ocr.set_model_tier(ocr::MODEL_TIER_BEST);
+            else return false;
+        } else if (arg == "--stream") {
+            opt.stream = true;
+        } else if (arg == "--stream-blocks") {
+            opt.stream = true;
+            opt.ocr.set_stream_level(ocr::STREAM_LEVEL_BLOCK);
+        } else if (arg == "--server-stats") {
+            opt.serverStats = true;
+        } else if (arg == "--set-faults") {
+            const char* v = next(); if (!v) return false;
+            opt.setFaults = v;
+        } else if (arg == "--dump-trace") {
+            const char* v = next(); if (!v) return false;
+            opt.dumpTrace = v;
+        } else if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (opt.input.empty()) {
+            opt.input = arg;
+        } else {
+            return false;
+        }
+    }
+
+    if (opt.input.empty()) opt.input = "-";
+    return true;
+}
+
+// same filter as the GUI's file dialog
+bool isImageFile(const fs::path& p) {
+    std::string ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" ||
+           ext == ".bmp" || ext == ".tif" || ext == ".tiff";
+}
+
+bool readFile(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    out = std::move(ss).str();
+    return true;
+}
+
+// enumerates input paths lazily; returns the number produced
+int producePaths(const CliOptions& opt, BoundedQueue<PathItem>& queue) {
+    int index = 0;
+
+    if (opt.input == "-") {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            queue.push({index++, line});
+        }
+        return index;
+    }
+
+    std::error_code ec;
+    auto visit = [&](const fs::directory_entry& entry) {
+        // a broken symlink or unreadable entry is skipped, not the end of the walk
+        std::error_code statError;
+        if (entry.is_regular_file(statError) && isImageFile(entry.path())) {
+            queue.push({index++, entry.path().string()});
+        }
+    };
+
+    if (opt.recursive) {
+        for (fs::recursive_directory_iterator it(opt.input, fs::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            visit(*it);
+        }
+    } else {
+        for (fs::directory_iterator it(opt.input, ec), end; !ec && it != end; it.increment(ec)) {
+            visit(*it);
+        }
+    }
+
+    if (ec) {
+        std::cerr << "[CLI] Error reading " << opt.input << ": " << ec.message() << std::endl;
+    }
+    return index;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CliOptions opt;
+    if (!parseArgs(argc, argv, opt)) {
+        printUsage();
+        return 2;
+    }
+
+    if (opt.serverStats) {
+        OcrRpcClient client(opt.server);
+        ocr::ServerStats stats;
+        std::string error, json;
+        if (!client.serverStats(stats, error)) {
+            std::cerr << "[CLI] GetServerStats failed: " << error << std::endl;
+            return 1;
+        }
+        google::protobuf::util::JsonPrintOptions print;
+        print.add_whitespace = true;
+        print.always_print_primitive_fields = true;
+        google::protobuf::util::MessageToJsonString(stats, &json, print);
+        std::cout << json << std::endl;
+        return 0;
+    }
+
+    if (opt.setFaults) {
+        OcrRpcClient client(opt.server);
+        std::string applied, error;
+        if (!client.setFaults(*opt.setFaults, applied, error)) {
+            std::cerr << "[CLI] SetFaults failed: " << error << std::endl;
+            return 1;
+        }
+        std::cerr << "[CLI] Server fault injection: " << applied << std::endl;
+        return 0;
+    }
+
+    if (!opt.dumpTrace.empty()) {
+        OcrRpcClient client(opt.server);
+        ocr::TraceDump dump;
+        std::string error;
+        if (!client.dumpTrace(dump, error)) {
+            std::cerr << "[CLI] DumpTrace failed: " << error << std::endl;
+            return 1;
+        }
+        if (!dump.enabled()) {
+            std::cerr << "[CLI] Tracing is off; start the server with --trace-events N" << std::endl;
+            return 1;
+        }
+        std::ofstream file(opt.dumpTrace, std::ios::binary);
+        file << dump.chrome_trace_json();
+        if (!file.flush()) {
+            std::cerr << "[CLI] Cannot write " << opt.dumpTrace << std::endl;
+            return 1;
+        }
+        std::cerr << "[CLI] Trace written to " << opt.dumpTrace
+                  << " | Spans: " << dump.spans_recorded()
+                  << " | Overwritten: " << dump.spans_dropped() << std::endl;
+        return 0;
+    }
+
+    ExportFormat format = exportFormatForPath(opt.output);
+    if (!opt.format.empty() && !parseExportFormat(opt.format, format)) {
+        printUsage();
+        return 2;
+    }
+    if (opt.stream && format != ExportFormat::Jsonl) {
+        std::cerr << "[CLI] --stream needs --format jsonl" << std::endl;
+        return 2;
+    }
+    if (opt.stream && !opt.hedge.empty()) {
+        std::cerr << "[CLI] --hedge doesn't work with --stream" << std::endl;
+        return 2;
+    }
+
+    // results go to disk as they arrive and aren't kept, so memory stays
+    // flat however large the batch
+    std::string error;
+    std::unique_ptr<ResultExporter> out = ResultExporter::open(
+        opt.output.empty() ? "-" : opt.output, format, error);
+    if (!out) {
+        std::cerr << "[CLI] Cannot open output file: " << error << std::endl;
+        return 1;
+    }
+
+    OcrRpcClient client(opt.server);
+    client.setOptions(opt.ocr);
+    client.setHashFirst(opt.hashFirst);
+    if (!opt.hedge.empty()) client.enableHedging(opt.hedge, opt.hedgePolicy);
+
+    if (opt.sharedMemory) {
+        // one slot per worker, so a request never waits for one
+        std::string error;
+        if (!client.enableSharedMemory(static_cast<uint32_t>(opt.concurrency),
+                                       opt.shmSlotMb << 20, error)) {
+            std::cerr << "[CLI] Cannot use shared memory: " << error << std::endl;
+            return 1;
+        }
+    }
+
+    // paths -> readers (read + hash) -> RPC workers. a couple of queued
+    // items per worker keeps them busy without buffering the batch, and
+    // reading/hashing the next files overlaps with the RPCs in flight
+    BoundedQueue<PathItem> paths(static_cast<size_t>(opt.concurrency) * 2);
+    BoundedQueue<LoadedItem> loaded(static_cast<size_t>(opt.concurrency) * 2);
+    std::atomic<int> done{0};
+    std::atomic<int> failed{0};
+    std::atomic<int> cacheHits{0};
+    std::atomic<int> nearDuplicates{0};
+    StageTimings timings;
+    std::atomic<long long> bytesSkipped{0};
+
+    auto start = std::chrono::steady_clock::now();
+
+    int readerCount = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) / 2, 2, 8);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < readerCount; i++) {
+        readers.emplace_back([&]() {
+            while (auto item = paths.pop()) {
+                LoadedItem loadedItem;
+                loadedItem.index = item->index;
+                loadedItem.path = std::move(item->path);
+                loadedItem.readOk = readFile(loadedItem.path, loadedItem.data);
+                if (loadedItem.readOk && opt.hashFirst) {
+                    loadedItem.sha256 = Sha256::toBytes(Sha256::hash(loadedItem.data));
+                }
+                loaded.push(std::move(loadedItem));
+            }
+        });
+    }
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < opt.concurrency; i++) {
+        workers.emplace_back([&]() {
+            while (auto item = loaded.pop()) {
+                OcrRpcResult res;
+                std::string name = fs::path(item->path).filename().string();
+                size_t bytes = item->data.size();
+
+                if (!item->readOk) {
+                    res.filename = name;
+                    res.error = "cannot read file";
+                } else if (opt.stream) {
+                    res = client.recognizeStream(
+                        opt.batchId, item->index, name, std::move(item->data),
+                        [&](const ocr::OcrPartial& p) {
+                            out->writePartial(item->index, p.sequence(), p.text(), p.confidence());
+                        },
+                        item->sha256);
+                } else {
+                    res = client.recognize(opt.batchId, item->index, name,
+                                           std::move(item->data), item->sha256);
+                }
+
+                out->write(item->index, item->path, res);
+
+                done++;
+                if (!res.success) failed++;
+                if (res.cacheHit) cacheHits++;
+                if (res.nearDuplicate) nearDuplicates++;
+                if (opt.timings) timings.add(res);
+                if (item->readOk && !res.uploaded) bytesSkipped += static_cast<long long>(bytes);
+            }
+        });
+    }
+
+    int total = producePaths(opt, paths);
+    paths.close();
+
+    for (auto& t : readers) t.join();
+    loaded.close();
+
+    for (auto& t : workers) t.join();
+
+    if (!out->close(error)) {
+        std::cerr << "[CLI] Writing results failed: " << error << std::endl;
+        return 1;
+    }
+
+    double secs = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << "[CLI] Processed " << done << "/" << total << " images"
+              << " | Failed: " << failed
+              << " | " << secs << " s"
+              << " | " << (secs > 0 ? done / secs : 0.0) << " img/s" << std::endl;
+
+    if (nearDuplicates > 0) {
+        std::cerr << "[CLI] Near-duplicates reused: " << nearDuplicates << std::endl;
+    }
+    if (opt.hashFirst) {
+        std::cerr << "[CLI] Cache hits: " << cacheHits << "/" << done
+                  << " | Upload skipped: " << (bytesSkipped >> 20) << " MB" << std::endl;
+    }
+    if (client.hedging()) {
+        HedgeStats h = client.hedgeStats();
+        // extra load: the hedges plus the primaries left running to measure them
+        double rate = h.requests > 0 ? 100.0 * (h.hedged + h.measured) / h.requests : 0.0;
+        std::cerr << "[CLI] Hedged: " << h.hedged << "/" << h.requests
+                  << " + measured " << h.measured
+                  << " (" << rate << "%, cap " << 100 * opt.hedgePolicy.maxRate << "%)"
+                  << " | Hedge won: " << h.hedgeWins
+                  << " | Over cap: " << h.capped
+                  << " | Delay: ";
+        if (h.delayUs >= 0) std::cerr << h.delayUs / 1000 << " ms";
+        else std::cerr << "still learning";
+        std::cerr << std::endl;
+        std::cerr << "[CLI] p99: " << h.p99Us / 1000 << " ms"
+                  << " | without hedging: ~" << h.p99PrimaryUs / 1000 << " ms"
+                  << " | gain: ~" << (h.p99PrimaryUs - h.p99Us) / 1000 << " ms" << std::endl;
+    }
+    if (opt.timings) timings.print();
+
+    return failed > 0 ? 1 : 0;
+}
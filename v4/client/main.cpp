@@ -1,11 +1,16 @@
 #include <QApplication>
 #include "MainWindow.h"
 
+// ./ocr_client [--hash-first]
+//
+//   --hash-first   ask by SHA-256 before uploading each image; only worth
+//                  it against a server started with --result-cache-mb
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
 
     MainWindow w;
+    w.setHashFirst(app.arguments().contains("--hash-first"));
     w.show();
 
     return app.exec();
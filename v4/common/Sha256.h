@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// SHA-256 (FIPS 180-4), for content-addressing images; no OpenSSL needed
+class Sha256 {
+public:
+    using Digest = std::array<uint8_t, 32>;
+
+    Sha256();
+
+    void update(const void* data, size_t size);
+    Digest finish();
+
+    static Digest hash(std::string_view data);
+
+    // the digest as raw bytes, e.g. for a protobuf bytes field
+    static std::string toBytes(const Digest& d) {
+        return std::string(reinterpret_cast<const char*>(d.data()), d.size());
+    }
+
+private:
+    void compress(const uint8_t* block);
+
+    uint32_t state_[8];
+    uint8_t buffer_[64];
+    size_t buffered_ = 0;
+    uint64_t totalBytes_ = 0;
+};
@@ -0,0 +1,320 @@
+#include "ShmRing.h"
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4f435252;     // "OCRR"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kPageSize = 4096;
+
+enum SlotState : uint32_t { kFree = 0, kWriting = 1, kCommitted = 2 };
+
+// start of the segment; written once by the creator
+struct RingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t reserved;
+    uint64_t slotSize;
+    uint64_t dataOffset;
+};
+
+// one per slot, on its own cache line; shared between processes, so only
+// lock-free atomics
+struct alignas(64) SlotControl {
+    std::atomic<uint32_t> state;
+    std::atomic<uint32_t> generation;
+    std::atomic<uint64_t> length;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "needs address-free atomics");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "needs address-free atomics");
+
+size_t roundUp(size_t n, size_t to) {
+    return (n + to - 1) / to * to;
+}
+
+size_t controlOffset() {
+    return roundUp(sizeof(RingHeader), alignof(SlotControl));
+}
+
+size_t dataOffset(uint32_t slotCount) {
+    return roundUp(controlOffset() + slotCount * sizeof(SlotControl), kPageSize);
+}
+
+SlotControl* controls(void* base) {
+    return reinterpret_cast<SlotControl*>(static_cast<char*>(base) + controlOffset());
+}
+
+const SlotControl* controls(const void* base) {
+    return reinterpret_cast<const SlotControl*>(static_cast<const char*>(base) + controlOffset());
+}
+
+std::string errnoText(const char* what) {
+    return std::string(what) + ": " + std::strerror(errno);
+}
+
+} // namespace
+
+bool isValidShmName(const std::string& name) {
+    if (name.size() < 6 || name.size() > 30) return false;
+    if (name.compare(0, 5, "/ocr-") != 0) return false;
+    for (size_t i = 5; i < name.size(); i++) {
+        char c = name[i];
+        if (!((c >= '0' && c <= '9') || c == '-')) return false;
+    }
+    return true;
+}
+
+// ---- ShmRing ----
+
+std::unique_ptr<ShmRing> ShmRing::create(uint32_t slotCount, size_t slotSize,
+                                         std::string& error) {
+    if (slotCount == 0 || slotSize == 0) {
+        error = "shared memory ring needs at least one non-empty slot";
+        return nullptr;
+    }
+
+    static std::atomic<int> counter{0};
+    std::string name = "/ocr-" + std::to_string(getpid()) + "-" +
+                       std::to_string(counter++);
+
+    slotSize = roundUp(slotSize, kPageSize);
+    size_t total = dataOffset(slotCount) + slotCount * slotSize;
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        // left behind by a crashed process that had our pid
+        shm_unlink(name.c_str());
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        error = errnoText("shm_open");
+        return nullptr;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(total)) != 0) {
+        error = errnoText("ftruncate");
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    void* base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        error = errnoText("mmap");
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    auto* header = static_cast<RingHeader*>(base);
+    header->magic = kMagic;
+    header->version = kVersion;
+    header->slotCount = slotCount;
+    header->reserved = 0;
+    header->slotSize = slotSize;
+    header->dataOffset = dataOffset(slotCount);
+
+    SlotControl* ctl = controls(base);
+    for (uint32_t i = 0; i < slotCount; i++) {
+        new (&ctl[i]) SlotControl{};
+    }
+
+    std::unique_ptr<ShmRing> ring(new ShmRing());
+    ring->name_ = name;
+    ring->slotCount_ = slotCount;
+    ring->slotSize_ = slotSize;
+    ring->base_ = base;
+    ring->mappedBytes_ = total;
+    return ring;
+}
+
+ShmRing::~ShmRing() {
+    munmap(base_, mappedBytes_);
+    shm_unlink(name_.c_str());
+}
+
+ShmRing::Lease ShmRing::tryAcquire() {
+    SlotControl* ctl = controls(base_);
+    uint32_t start = next_.fetch_add(1, std::memory_order_relaxed);
+
+    for (uint32_t n = 0; n < slotCount_; n++) {
+        uint32_t i = (start + n) % slotCount_;
+        uint32_t expected = kFree;
+        if (!ctl[i].state.compare_exchange_strong(expected, kWriting,
+                                                  std::memory_order_acquire)) {
+            continue;
+        }
+
+        Lease lease;
+        lease.ring_ = this;
+        lease.slot_ = i;
+        lease.generation_ = ctl[i].generation.fetch_add(1, std::memory_order_relaxed) + 1;
+        lease.data_ = static_cast<char*>(base_) + dataOffset(slotCount_) + i * slotSize_;
+        return lease;
+    }
+    return Lease();
+}
+
+// ---- ShmRing::Lease ----
+
+ShmRing::Lease::Lease(Lease&& other) noexcept
+    : ring_(other.ring_), slot_(other.slot_),
+      generation_(other.generation_), data_(other.data_)
+{
+    other.ring_ = nullptr;
+}
+
+ShmRing::Lease& ShmRing::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        ring_ = other.ring_;
+        slot_ = other.slot_;
+        generation_ = other.generation_;
+        data_ = other.data_;
+        other.ring_ = nullptr;
+    }
+    return *this;
+}
+
+ShmRing::Lease::~Lease() {
+    release();
+}
+
+size_t ShmRing::Lease::capacity() const {
+    return ring_ ? ring_->slotSize_ : 0;
+}
+
+ShmSlotHandle ShmRing::Lease::commit(size_t length) {
+    SlotControl& ctl = controls(ring_->base_)[slot_];
+    ctl.length.store(length, std::memory_order_relaxed);
+    ctl.state.store(kCommitted, std::memory_order_release);
+
+    ShmSlotHandle handle;
+    handle.segment = ring_->name_;
+    handle.slot = slot_;
+    handle.generation = generation_;
+    handle.length = length;
+    return handle;
+}
+
+void ShmRing::Lease::release() {
+    if (!ring_) return;
+    controls(ring_->base_)[slot_].state.store(kFree, std::memory_order_release);
+    ring_ = nullptr;
+}
+
+// ---- ShmMapping ----
+
+std::shared_ptr<const ShmMapping> ShmMapping::open(const std::string& name,
+                                                   std::string& error) {
+    if (!isValidShmName(name)) {
+        error = "invalid shared memory segment name";
+        return nullptr;
+    }
+
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        error = errnoText("shm_open");
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(RingHeader))) {
+        error = "shared memory segment is too small";
+        close(fd);
+        return nullptr;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        error = errnoText("mmap");
+        return nullptr;
+    }
+
+    std::shared_ptr<ShmMapping> mapping(new ShmMapping());
+    mapping->base_ = base;
+    mapping->mappedBytes_ = size;
+
+    // the creator may be hostile or from another build; check everything
+    // view() will rely on against what is actually mapped
+    const auto* header = static_cast<const RingHeader*>(base);
+    uint64_t needed = 0;
+    if (header->magic != kMagic || header->version != kVersion) {
+        error = "not an OCR shared memory ring";
+        return nullptr;
+    }
+    if (header->slotCount == 0 || header->slotSize == 0 ||
+        header->dataOffset != dataOffset(header->slotCount) ||
+        __builtin_mul_overflow(static_cast<uint64_t>(header->slotCount), header->slotSize, &needed) ||
+        __builtin_add_overflow(needed, header->dataOffset, &needed) ||
+        needed > size) {
+        error = "shared memory ring header does not match its size";
+        return nullptr;
+    }
+    return mapping;
+}
+
+ShmMapping::~ShmMapping() {
+    munmap(const_cast<void*>(base_), mappedBytes_);
+}
+
+bool ShmMapping::view(const ShmSlotHandle& handle, std::string_view& out,
+                      std::string& error) const {
+    const auto* header = static_cast<const RingHeader*>(base_);
+    if (handle.slot >= header->slotCount) {
+        error = "shared memory slot out of range";
+        return false;
+    }
+    if (handle.length > header->slotSize) {
+        error = "shared memory slot length out of range";
+        return false;
+    }
+
+    const SlotControl& ctl = controls(base_)[handle.slot];
+    if (ctl.state.load(std::memory_order_acquire) != kCommitted ||
+        ctl.generation.load(std::memory_order_relaxed) != handle.generation) {
+        error = "shared memory slot is stale";
+        return false;
+    }
+
+    const char* data = static_cast<const char*>(base_) + header->dataOffset +
+                       handle.slot * header->slotSize;
+    out = std::string_view(data, handle.length);
+    return true;
+}
+
+// ---- ShmMappingCache ----
+
+std::shared_ptr<const ShmMapping> ShmMappingCache::get(const std::string& name,
+                                                       std::string& error) {
+    std::lock_guard<std::mutex> lock(mtx_);
+
+    auto it = segments_.find(name);
+    if (it != segments_.end()) return it->second;
+
+    auto mapping = ShmMapping::open(name, error);
+    if (!mapping) return nullptr;
+
+    // clients normally hold one segment for life; a full cache means many
+    // came and went, so start over rather than track recency
+    if (segments_.size() >= kMaxSegments) segments_.clear();
+    segments_[name] = mapping;
+    return mapping;
+}
+
+void ShmMappingCache::forget(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    segments_.erase(name);
+}
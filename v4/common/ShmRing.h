@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// A POSIX shared-memory segment split into fixed-size slots, so a client on
+// the same host as the server can hand over image bytes without pushing them
+// through protobuf and a socket. The client (ShmRing) owns the segment and
+// writes into free slots; the RPC only names the segment and slot, and the
+// server (ShmMapping) maps the segment read-only and reads in place.
+//
+// A slot belongs to the client from acquire() until the Lease is dropped,
+// which the client only does once the RPC using it has returned.
+
+struct ShmSlotHandle {
+    std::string segment;
+    uint32_t slot = 0;
+    uint32_t generation = 0;    // bumped on every acquire, catches stale handles
+    uint64_t length = 0;
+};
+
+// segment names are "/ocr-<pid>-<n>", short enough for macOS' 31-char limit
+bool isValidShmName(const std::string& name);
+
+// writer side, one per client
+class ShmRing {
+public:
+    // a claimed slot; frees it on destruction
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        explicit operator bool() const { return ring_ != nullptr; }
+        char* data() const { return data_; }
+        size_t capacity() const;
+
+        // records how many bytes were written and returns the RPC handle
+        ShmSlotHandle commit(size_t length);
+
+    private:
+        friend class ShmRing;
+        void release();
+
+        ShmRing* ring_ = nullptr;
+        uint32_t slot_ = 0;
+        uint32_t generation_ = 0;
+        char* data_ = nullptr;
+    };
+
+    // nullptr (and error set) if the segment can't be created
+    static std::unique_ptr<ShmRing> create(uint32_t slotCount, size_t slotSize,
+                                           std::string& error);
+    ~ShmRing();
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    // never blocks; an empty Lease means every slot is in use
+    Lease tryAcquire();
+
+    const std::string& name() const { return name_; }
+    uint32_t slotCount() const { return slotCount_; }
+    size_t slotSize() const { return slotSize_; }
+
+private:
+    ShmRing() = default;
+
+    std::string name_;
+    uint32_t slotCount_ = 0;
+    size_t slotSize_ = 0;
+    void* base_ = nullptr;
+    size_t mappedBytes_ = 0;
+    std::atomic<uint32_t> next_{0};     // where the next free-slot scan starts
+};
+
+// reader side: a read-only view of someone else's segment
+class ShmMapping {
+public:
+    static std::shared_ptr<const ShmMapping> open(const std::string& name,
+                                                  std::string& error);
+    ~ShmMapping();
+
+    ShmMapping(const ShmMapping&) = delete;
+    ShmMapping& operator=(const ShmMapping&) = delete;
+
+    // the committed bytes of a slot, after checking the handle against the
+    // segment's bounds and the slot's current generation
+    bool view(const ShmSlotHandle& handle, std::string_view& out,
+              std::string& error) const;
+
+private:
+    ShmMapping() = default;
+
+    const void* base_ = nullptr;
+    size_t mappedBytes_ = 0;
+};
+
+// keeps segments mapped across requests, since clients reuse one for life
+class ShmMappingCache {
+public:
+    std::shared_ptr<const ShmMapping> get(const std::string& name, std::string& error);
+
+    // drops a mapping that no longer checks out, e.g. the client restarted
+    void forget(const std::string& name);
+
+private:
+    static constexpr size_t kMaxSegments = 64;
+
+    std::mutex mtx_;
+    std::map<std::string, std::shared_ptr<const ShmMapping>> segments_;
+};
@@ -0,0 +1,128 @@
+#include "CostModel.h"
+
+#include <leptonica/allheaders.h>
+
+#include <algorithm>
+#include <cmath>
+
+// each observation scales the weight of all earlier ones by this
+static constexpr double kDecay = 0.995;
+
+// a fit is trusted once it has this much (decayed) data behind it
+static constexpr double kMinWeight = 8;
+
+// keeps the solve stable while one feature hardly varies (e.g. a batch of
+// same-size labels)
+static constexpr double kRidge = 1e-3;
+
+// before anything is measured: a typical page-per-second machine
+static constexpr double kPriorFixedUs = 30000;
+static constexpr double kPriorUsPerMegapixel = 300000;
+
+static constexpr long long kMinPredictionUs = 1000;
+
+// settings with a fit of their own, as EnginePool's engine configs
+static constexpr size_t kMaxFits = 64;
+
+CostModel::Features CostModel::features(std::string_view imageData) {
+    Features f;
+    f.megabytes = imageData.size() / 1e6;
+
+    l_int32 format = 0, w = 0, h = 0, bps = 0, spp = 0, cmap = 0;
+    if (pixReadHeaderMem((const l_uint8*)imageData.data(), imageData.size(),
+                         &format, &w, &h, &bps, &spp, &cmap) == 0) {
+        f.megapixels = static_cast<double>(w) * h / 1e6;
+    }
+    return f;
+}
+
+void CostModel::Fit::add(const double x[kTerms], double y) {
+    for (int i = 0; i < kTerms; i++) {
+        for (int j = 0; j < kTerms; j++) {
+            xtx[i][j] = xtx[i][j] * kDecay + x[i] * x[j];
+        }
+        xty[i] = xty[i] * kDecay + x[i] * y;
+    }
+    weight = weight * kDecay + 1;
+
+    // Gaussian elimination with partial pivoting on the ridge system
+    double a[kTerms][kTerms + 1];
+    for (int i = 0; i < kTerms; i++) {
+        for (int j = 0; j < kTerms; j++) a[i][j] = xtx[i][j];
+        a[i][i] += kRidge * weight;
+        a[i][kTerms] = xty[i];
+    }
+    for (int col = 0; col < kTerms; col++) {
+        int pivot = col;
+        for (int r = col + 1; r < kTerms; r++) {
+            if (std::fabs(a[r][col]) > std::fabs(a[pivot][col])) pivot = r;
+        }
+        if (std::fabs(a[pivot][col]) < 1e-12) {
+            solved = false;
+            return;
+        }
+        std::swap(a[col], a[pivot]);
+        for (int r = 0; r < kTerms; r++) {
+            if (r == col) continue;
+            double f = a[r][col] / a[col][col];
+            for (int c = col; c <= kTerms; c++) a[r][c] -= f * a[col][c];
+        }
+    }
+    for (int i = 0; i < kTerms; i++) coef[i] = a[i][kTerms] / a[i][i];
+    solved = true;
+}
+
+bool CostModel::Fit::predict(const double x[kTerms], double& y) const {
+    if (!solved || weight < kMinWeight) return false;
+    y = 0;
+    for (int i = 0; i < kTerms; i++) y += coef[i] * x[i];
+    return true;
+}
+
+long long CostModel::predictUs(const std::string& settings, const Features& f) {
+    const double x[kTerms] = {1.0, f.megapixels, f.megabytes};
+    double y = 0;
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = fits_.find(settings);
+    if (!(it != fits_.end() && it->second.fit.predict(x, y)) && !global_.predict(x, y)) {
+        y = kPriorFixedUs + kPriorUsPerMegapixel * f.megapixels;
+    }
+    return std::max(kMinPredictionUs, static_cast<long long>(y));
+}
+
+void CostModel::observe(const std::string& settings, const Features& f, long long actualUs) {
+    long long predicted = predictUs(settings, f);
+    const double x[kTerms] = {1.0, f.megapixels, f.megabytes};
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    fitLocked(settings).add(x, static_cast<double>(actualUs));
+    global_.add(x, static_cast<double>(actualUs));
+
+    const double error = std::fabs(static_cast<double>(predicted - actualUs));
+    meanAbsErrorUs_ = samples_ == 0 ? error : meanAbsErrorUs_ * 0.98 + error * 0.02;
+    samples_++;
+}
+
+CostModel::Fit& CostModel::fitLocked(const std::string& settings) {
+    auto it = fits_.find(settings);
+    if (it != fits_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+        return it->second.fit;
+    }
+
+    if (fits_.size() >= kMaxFits) {
+        fits_.erase(lru_.back());
+        lru_.pop_back();
+    }
+    lru_.push_front(settings);
+    Entry& entry = fits_[settings];
+    entry.lru = lru_.begin();
+    return entry.fit;
+}
+
+void CostModel::fill(ocr::ServerStats* out) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    out->set_cost_model_samples(samples_);
+    out->set_cost_model_error_ms(static_cast<long long>(meanAbsErrorUs_ / 1000));
+}
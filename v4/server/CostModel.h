@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ocr.pb.h"
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Predicts how long a job will take from what is known before decoding it:
+// the image size from its header, the encoded size, and the settings. A
+// linear fit per settings (ms ~ a + b * megapixels + c * megabytes) is
+// refitted as jobs finish, with older jobs weighing less and less, so it
+// follows the machine and the models actually in use. Settings come from
+// clients (language, whitelist), so only the kMaxFits most recently used
+// get a fit of their own; the rest are predicted from all jobs.
+class CostModel {
+public:
+    struct Features {
+        double megapixels = 0;      // 0 if the header couldn't be read
+        double megabytes = 0;
+    };
+
+    static Features features(std::string_view imageData);
+
+    long long predictUs(const std::string& settings, const Features& f);
+    void observe(const std::string& settings, const Features& f, long long actualUs);
+
+    void fill(ocr::ServerStats* out);
+
+private:
+    static constexpr int kTerms = 3;
+
+    // decayed normal equations of a least-squares fit
+    struct Fit {
+        double xtx[kTerms][kTerms] = {};
+        double xty[kTerms] = {};
+        double weight = 0;          // decayed sample count
+        double coef[kTerms] = {};
+        bool solved = false;
+
+        void add(const double x[kTerms], double y);
+        bool predict(const double x[kTerms], double& y) const;
+    };
+
+    struct Entry {
+        Fit fit;
+        std::list<std::string>::iterator lru;
+    };
+
+    // fit for settings, created (evicting the least recently used) if new;
+    // caller holds mtx_
+    Fit& fitLocked(const std::string& settings);
+
+    std::mutex mtx_;
+    std::unordered_map<std::string, Entry> fits_;
+    std::list<std::string> lru_;    // settings with a fit, most recently used first
+    Fit global_;                    // all settings, until a fit has its own data
+    long long samples_ = 0;
+    double meanAbsErrorUs_ = 0;     // decayed, of predictions made before observing
+};
@@ -0,0 +1,272 @@
+#include "EnginePool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+// how many recent load/evict events GetServerStats returns
+static constexpr size_t kMaxEvents = 64;
+
+// a loaded engine takes roughly this many times its traineddata on disk
+// (unpacked LSTM weights, dawgs, classifier tables), plus a fixed base
+static constexpr size_t kTraineddataFactor = 3;
+static constexpr size_t kEngineBaseBytes = 8u << 20;
+
+// distinct configs with engines at once, and failed ones remembered
+static constexpr size_t kMaxConfigs = 64;
+
+// a config whose Init() failed is tried again after this long, in case
+// its traineddata has been installed since
+static constexpr auto kBrokenRetry = std::chrono::minutes(1);
+
+EnginePool::Lease::Lease(EnginePool* pool, std::unique_ptr<OcrEngine> engine)
+    : pool_(pool), engine_(std::move(engine))
+{}
+
+EnginePool::Lease::Lease(Lease&& other) noexcept
+    : pool_(other.pool_), engine_(std::move(other.engine_))
+{
+    other.pool_ = nullptr;
+}
+
+EnginePool::Lease& EnginePool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = other.pool_;
+        engine_ = std::move(other.engine_);
+        other.pool_ = nullptr;
+    }
+    return *this;
+}
+
+EnginePool::Lease::~Lease() {
+    release();
+}
+
+void EnginePool::Lease::release() {
+    if (pool_ && engine_) pool_->giveBack(std::move(engine_));
+    pool_ = nullptr;
+}
+
+
+EnginePool::EnginePool(std::string tessdataDir, size_t memoryBudgetBytes)
+    : tessdataDir_(std::move(tessdataDir)),
+      budgetBytes_(memoryBudgetBytes)
+{}
+
+void EnginePool::setTierDir(ModelTier tier, std::string dir) {
+    tierDirs_[static_cast<int>(tier)] = std::move(dir);
+}
+
+bool EnginePool::hasTierDir(ModelTier tier) const {
+    return tier == ModelTier::Standard || !tierDirs_[static_cast<int>(tier)].empty();
+}
+
+const std::string& EnginePool::dirFor(ModelTier tier) const {
+    const std::string& dir = tierDirs_[static_cast<int>(tier)];
+    return dir.empty() ? tessdataDir_ : dir;
+}
+
+size_t EnginePool::estimateBytes(const EngineConfig& cfg) const {
+    size_t bytes = kEngineBaseBytes;
+
+    // "deu+eng" loads both models
+    std::stringstream ss(cfg.language);
+    std::string lang;
+    while (std::getline(ss, lang, '+')) {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(
+            std::filesystem::path(dirFor(cfg.tier)) / (lang + ".traineddata"), ec);
+        if (!ec) bytes += static_cast<size_t>(size) * kTraineddataFactor;
+    }
+    return bytes;
+}
+
+EnginePool::Lease EnginePool::acquire(const EngineConfig& cfg) {
+    const std::string key = cfg.key();
+    std::vector<std::unique_ptr<OcrEngine>> evicted;
+    size_t bytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (brokenLocked(key)) return {};
+
+        // a config we have no engines for needs a slot
+        if (!keys_.count(key)) {
+            while (keys_.size() >= kMaxConfigs && evictOneLocked(evicted)) {}
+            if (keys_.size() >= kMaxConfigs) {
+                std::cout << "[Engine] Refused " << key << ": all "
+                          << kMaxConfigs << " engine configs are in use" << std::endl;
+                return {};
+            }
+        }
+
+        KeyState& state = keys_[key];
+        if (!state.idle.empty()) {
+            auto it = state.idle.back();
+            state.idle.pop_back();
+
+            std::unique_ptr<OcrEngine> engine = std::move(it->engine);
+            lru_.erase(it);
+            state.busy++;
+            return Lease(this, std::move(engine));
+        }
+
+        if (state.bytesPerEngine == 0) {
+            state.language = cfg.language;
+            state.bytesPerEngine = estimateBytes(cfg);
+        }
+        bytes = state.bytesPerEngine;
+
+        // reserve the memory now so concurrent loads don't overshoot together
+        evictForLocked(bytes, evicted);
+        totalBytes_ += bytes;
+        state.busy++;
+    }
+    evicted.clear();   // End() outside the lock
+
+    // Init() takes a while, so it runs outside the lock
+    auto engine = std::make_unique<OcrEngine>(cfg, dirFor(cfg.tier));
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!engine->initialized()) {
+        KeyState& state = keys_[key];
+        state.busy--;
+        totalBytes_ -= bytes;
+        if (state.busy == 0 && state.idle.empty()) keys_.erase(key);
+        markBrokenLocked(key);
+        return {};
+    }
+
+    languages_[cfg.language].loads++;
+    recordEventLocked("load", cfg.language);
+    std::cout << "[Engine] Loaded engine for " << key
+              << " (~" << (bytes >> 20) << " MB, pool total ~"
+              << (totalBytes_ >> 20) << " MB)" << std::endl;
+
+    return Lease(this, std::move(engine));
+}
+
+void EnginePool::prewarm(const EngineConfig& cfg, int count) {
+    std::vector<Lease> leases;
+    for (int i = 0; i < count; i++) {
+        Lease lease = acquire(cfg);
+        if (!lease) break;
+        leases.push_back(std::move(lease));
+    }
+    // leases go back to the idle list here
+}
+
+void EnginePool::giveBack(std::unique_ptr<OcrEngine> engine) {
+    std::vector<std::unique_ptr<OcrEngine>> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        const std::string key = engine->config().key();
+        KeyState& state = keys_[key];
+        state.busy--;
+
+        lru_.push_front(Idle{key, std::move(engine)});
+        state.idle.push_back(lru_.begin());
+
+        // we may be over budget from loads that happened while all were busy
+        evictForLocked(0, evicted);
+    }
+}
+
+void EnginePool::evictForLocked(size_t incoming,
+                                std::vector<std::unique_ptr<OcrEngine>>& evicted)
+{
+    if (budgetBytes_ == 0) return;
+
+    while (totalBytes_ + incoming > budgetBytes_ && evictOneLocked(evicted)) {}
+}
+
+bool EnginePool::evictOneLocked(std::vector<std::unique_ptr<OcrEngine>>& evicted) {
+    if (lru_.empty()) return false;
+
+    auto victim = std::prev(lru_.end());
+    const std::string key = victim->key;
+    KeyState& state = keys_[key];
+
+    auto& idle = state.idle;
+    idle.erase(std::find(idle.begin(), idle.end(), victim));
+    totalBytes_ -= state.bytesPerEngine;
+
+    languages_[state.language].evictions++;
+    recordEventLocked("evict", state.language);
+    std::cout << "[Engine] Evicted idle engine for " << key
+              << " (pool total ~" << (totalBytes_ >> 20) << " MB)" << std::endl;
+
+    evicted.push_back(std::move(victim->engine));
+    lru_.erase(victim);
+
+    // its slot goes to the next new config
+    if (state.busy == 0 && state.idle.empty()) keys_.erase(key);
+    return true;
+}
+
+bool EnginePool::brokenLocked(const std::string& key) {
+    auto it = broken_.find(key);
+    if (it == broken_.end()) return false;
+    if (std::chrono::steady_clock::now() - it->second < kBrokenRetry) return true;
+
+    broken_.erase(it);
+    return false;
+}
+
+void EnginePool::markBrokenLocked(const std::string& key) {
+    const auto now = std::chrono::steady_clock::now();
+    if (broken_.size() >= kMaxConfigs) {
+        std::erase_if(broken_, [&](const auto& entry) {
+            return now - entry.second >= kBrokenRetry;
+        });
+    }
+    // still full of recent failures: forget the oldest
+    if (broken_.size() >= kMaxConfigs) {
+        broken_.erase(std::min_element(broken_.begin(), broken_.end(),
+            [](const auto& a, const auto& b) { return a.second < b.second; }));
+    }
+    broken_[key] = now;
+}
+
+void EnginePool::recordEventLocked(const char* kind, const std::string& language) {
+    ocr::EngineEvent event;
+    event.set_kind(kind);
+    event.set_language(language);
+    event.set_unix_ms(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+
+    events_.push_back(std::move(event));
+    if (events_.size() > kMaxEvents) events_.pop_front();
+}
+
+void EnginePool::fill(ocr::ServerStats* out) {
+    std::lock_guard<std::mutex> lock(mtx_);
+
+    std::unordered_map<std::string, ocr::LanguagePoolStats> byLanguage;
+    for (const auto& [key, state] : keys_) {
+        if (state.language.empty()) continue;
+        auto& lang = byLanguage[state.language];
+        lang.set_language(state.language);
+        lang.set_idle_engines(lang.idle_engines() + static_cast<int>(state.idle.size()));
+        lang.set_busy_engines(lang.busy_engines() + state.busy);
+        lang.set_memory_bytes(lang.memory_bytes() +
+            static_cast<long long>(state.bytesPerEngine) * (state.idle.size() + state.busy));
+    }
+    for (const auto& [language, counters] : languages_) {
+        auto& lang = byLanguage[language];
+        lang.set_language(language);
+        lang.set_loads(counters.loads);
+        lang.set_evictions(counters.evictions);
+    }
+
+    for (auto& [language, stats] : byLanguage) {
+        *out->add_language_pools() = std::move(stats);
+    }
+    for (const auto& event : events_) {
+        *out->add_engine_events() = event;
+    }
+    out->set_engine_memory_bytes(static_cast<long long>(totalBytes_));
+    out->set_engine_memory_budget_bytes(static_cast<long long>(budgetBytes_));
+}
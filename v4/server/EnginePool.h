@@ -0,0 +1,125 @@
+#pragma once
+
+#include "OcrEngine.h"
+#include "ocr.pb.h"
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Warm Tesseract engines, one idle list per distinct EngineConfig.
+// An engine is Init()'d once and then reused by every later job with the
+// same settings, so switching settings never costs a per-request Init().
+//
+// Engines for a language are only created the first time that language is
+// requested. With a memory budget set, idle engines are evicted least
+// recently used first whenever the estimated total goes over it, so rare
+// languages give their memory back to the common ones. Busy engines are
+// never evicted; the budget can be exceeded while they are all in use.
+//
+// Clients pick the language, page segmentation, engine mode and whitelist,
+// so the number of distinct configs is theirs to choose too. At most
+// kMaxConfigs have engines (or a failed Init()) at once; a new one evicts
+// the least recently used idle engines to make room, and is refused while
+// every config is busy.
+class EnginePool {
+public:
+    // exclusive use of one engine; hands it back to the pool when destroyed
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(EnginePool* pool, std::unique_ptr<OcrEngine> engine);
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        OcrEngine* get() const { return engine_.get(); }
+        OcrEngine* operator->() const { return engine_.get(); }
+        explicit operator bool() const { return engine_ != nullptr; }
+
+    private:
+        void release();
+
+        EnginePool* pool_ = nullptr;
+        std::unique_ptr<OcrEngine> engine_;
+    };
+
+    // memoryBudgetBytes = 0 means no limit
+    explicit EnginePool(std::string tessdataDir, size_t memoryBudgetBytes = 0);
+
+    EnginePool(const EnginePool&) = delete;
+    EnginePool& operator=(const EnginePool&) = delete;
+
+    // reuses an idle engine for cfg, or creates one; empty lease if Init() fails
+    Lease acquire(const EngineConfig& cfg);
+
+    // creates engines up front so the first requests don't pay for Init()
+    void prewarm(const EngineConfig& cfg, int count);
+
+    // per-language pool sizes, load/evict counts and recent events
+    void fill(ocr::ServerStats* out);
+
+    // models for a tier live in their own folder (tessdata_fast, tessdata_best);
+    // tiers without one fall back to the main tessdata folder
+    void setTierDir(ModelTier tier, std::string dir);
+    bool hasTierDir(ModelTier tier) const;
+    const std::string& dirFor(ModelTier tier) const;
+
+    const std::string& tessdataDir() const { return tessdataDir_; }
+
+private:
+    struct Idle {
+        std::string key;
+        std::unique_ptr<OcrEngine> engine;
+    };
+
+    struct KeyState {
+        std::string language;
+        size_t bytesPerEngine = 0;
+        int busy = 0;
+        std::vector<std::list<Idle>::iterator> idle;
+    };
+
+    struct LanguageCounters {
+        long long loads = 0;
+        long long evictions = 0;
+    };
+
+    void giveBack(std::unique_ptr<OcrEngine> engine);
+
+    // evicts LRU idle engines until `incoming` more bytes fit; caller holds mtx_
+    void evictForLocked(size_t incoming, std::vector<std::unique_ptr<OcrEngine>>& evicted);
+
+    // evicts the least recently used idle engine; false if there is none
+    bool evictOneLocked(std::vector<std::unique_ptr<OcrEngine>>& evicted);
+
+    // true if cfg's Init() failed recently; forgets failures that are old
+    bool brokenLocked(const std::string& key);
+    void markBrokenLocked(const std::string& key);
+
+    void recordEventLocked(const char* kind, const std::string& language);
+
+    size_t estimateBytes(const EngineConfig& cfg) const;
+
+    std::string tessdataDir_;
+    std::string tierDirs_[3];
+    size_t budgetBytes_;
+
+    std::mutex mtx_;
+    std::list<Idle> lru_;       // idle engines, most recently used first
+    std::unordered_map<std::string, KeyState> keys_;
+    std::unordered_map<std::string, LanguageCounters> languages_;
+    size_t totalBytes_ = 0;
+
+    std::deque<ocr::EngineEvent> events_;
+
+    // configs whose Init() failed (e.g. missing traineddata), and when;
+    // not retried until kBrokenRetry has passed
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> broken_;
+};
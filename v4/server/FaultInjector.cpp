@@ -0,0 +1,233 @@
+#include "FaultInjector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+
+// specs arrive over the network (SetFaults), so every value is bounded
+// before it is converted or multiplied up to microseconds
+static constexpr double kMaxMs = 600000;            // 10 minutes, delay or stall
+static constexpr double kMaxSlowWorkers = 4096;
+static constexpr double kMaxSlowFactor = 1000;
+
+// a single number, all of s
+static bool parseNumber(const std::string& s, double& out) {
+    if (s.empty()) return false;
+    char* end = nullptr;
+    out = std::strtod(s.c_str(), &end);
+    return *end == '\0' && std::isfinite(out) && out >= 0;
+}
+
+// a whole number in [0, max], for the fields stored as int
+static bool parseCount(const std::string& s, double max, int& out) {
+    double n = 0;
+    if (!parseNumber(s, n) || n > max || n != std::floor(n)) return false;
+    out = static_cast<int>(n);
+    return true;
+}
+
+// "a<sep>b" into two numbers
+static bool parsePair(const std::string& s, char sep, double& a, double& b) {
+    size_t at = s.find(sep);
+    return at != std::string::npos &&
+           parseNumber(s.substr(0, at), a) && parseNumber(s.substr(at + 1), b);
+}
+
+static bool parseDelay(const std::string& v, FaultInjector::Config& cfg) {
+    using Delay = FaultInjector::Config::Delay;
+
+    size_t colon = v.find(':');
+    if (colon == std::string::npos) return false;
+    const std::string kind = v.substr(0, colon);
+    const std::string args = v.substr(colon + 1);
+
+    if (kind == "fixed") {
+        cfg.delay = Delay::Fixed;
+        return parseNumber(args, cfg.delayA) && cfg.delayA <= kMaxMs;
+    }
+    if (kind == "uniform") {
+        cfg.delay = Delay::Uniform;
+        return parsePair(args, '-', cfg.delayA, cfg.delayB) && cfg.delayA <= cfg.delayB &&
+               cfg.delayB <= kMaxMs;
+    }
+    if (kind == "exp") {
+        cfg.delay = Delay::Exponential;
+        return parseNumber(args, cfg.delayA) && cfg.delayA > 0 && cfg.delayA <= kMaxMs;
+    }
+    if (kind == "lognormal") {
+        cfg.delay = Delay::LogNormal;
+        return parsePair(args, ':', cfg.delayA, cfg.delayB) && cfg.delayA > 0 &&
+               cfg.delayA <= kMaxMs && cfg.delayB <= 10;
+    }
+    return false;
+}
+
+bool FaultInjector::Config::any() const {
+    return delay != Delay::None || failRate > 0 || stallRate > 0 || slowWorkers > 0;
+}
+
+bool FaultInjector::parse(const std::string& spec, Config& out, std::string& error) {
+    Config cfg;
+    if (spec.empty() || spec == "off") {
+        out = cfg;
+        return true;
+    }
+
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) continue;
+
+        size_t eq = item.find('=');
+        const std::string key = item.substr(0, eq);
+        const std::string value = eq == std::string::npos ? "" : item.substr(eq + 1);
+
+        double n = 0;
+        bool ok = false;
+        if (key == "delay") {
+            ok = parseDelay(value, cfg);
+        } else if (key == "fail" && parseNumber(value, n)) {
+            cfg.failRate = n;
+            ok = n <= 1;
+        } else if (key == "stall" && parseNumber(value, n)) {
+            cfg.stallRate = n;
+            ok = n <= 1;
+        } else if (key == "stall-ms") {
+            ok = parseCount(value, kMaxMs, cfg.stallMs);
+        } else if (key == "slow-workers") {
+            ok = parseCount(value, kMaxSlowWorkers, cfg.slowWorkers);
+        } else if (key == "slow-factor" && parseNumber(value, n)) {
+            cfg.slowFactor = n;
+            ok = n >= 1 && n <= kMaxSlowFactor;
+        }
+
+        if (!ok) {
+            error = "bad fault spec item: " + item;
+            return false;
+        }
+    }
+    out = cfg;
+    return true;
+}
+
+std::string FaultInjector::format(const Config& cfg) {
+    using Delay = Config::Delay;
+    if (!cfg.any()) return "off";
+
+    std::ostringstream s;
+    const char* sep = "";
+    switch (cfg.delay) {
+        case Delay::None: break;
+        case Delay::Fixed:       s << "delay=fixed:" << cfg.delayA; break;
+        case Delay::Uniform:     s << "delay=uniform:" << cfg.delayA << "-" << cfg.delayB; break;
+        case Delay::Exponential: s << "delay=exp:" << cfg.delayA; break;
+        case Delay::LogNormal:   s << "delay=lognormal:" << cfg.delayA << ":" << cfg.delayB; break;
+    }
+    if (cfg.delay != Delay::None) sep = ",";
+
+    if (cfg.failRate > 0) { s << sep << "fail=" << cfg.failRate; sep = ","; }
+    if (cfg.stallRate > 0) {
+        s << sep << "stall=" << cfg.stallRate << ",stall-ms=" << cfg.stallMs;
+        sep = ",";
+    }
+    if (cfg.slowWorkers > 0) {
+        s << sep << "slow-workers=" << cfg.slowWorkers << ",slow-factor=" << cfg.slowFactor;
+    }
+    return s.str();
+}
+
+void FaultInjector::set(const Config& cfg) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    cfg_ = std::make_shared<Config>(cfg);
+    enabled_.store(cfg.any(), std::memory_order_relaxed);
+}
+
+std::string FaultInjector::spec() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return format(*cfg_);
+}
+
+double FaultInjector::uniform01() {
+    thread_local std::mt19937_64 rng{std::random_device{}()};
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+}
+
+bool FaultInjector::shouldFail() {
+    if (!enabled_.load(std::memory_order_relaxed)) return false;
+
+    double rate;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        rate = cfg_->failRate;
+    }
+    if (rate <= 0 || uniform01() >= rate) return false;
+
+    failures_++;
+    return true;
+}
+
+long long FaultInjector::workerDelayUs(int workerId, long long workUs) {
+    using Delay = Config::Delay;
+    if (!enabled_.load(std::memory_order_relaxed)) return 0;
+
+    std::shared_ptr<const Config> cfg;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        cfg = cfg_;
+    }
+
+    double ms = 0;
+    switch (cfg->delay) {
+        case Delay::None: break;
+        case Delay::Fixed:
+            ms = cfg->delayA;
+            break;
+        case Delay::Uniform:
+            ms = cfg->delayA + (cfg->delayB - cfg->delayA) * uniform01();
+            break;
+        case Delay::Exponential:
+            ms = -cfg->delayA * std::log1p(-uniform01());
+            break;
+        case Delay::LogNormal: {
+            // Box-Muller; 1 - u keeps the log argument above 0
+            const double z = std::sqrt(-2.0 * std::log1p(-uniform01())) *
+                             std::cos(2.0 * M_PI * uniform01());
+            ms = cfg->delayA * std::exp(cfg->delayB * z);
+            break;
+        }
+    }
+
+    // exp / lognormal tails are unbounded
+    long long us = static_cast<long long>(std::min(ms, kMaxMs) * 1000);
+    if (workerId >= 0 && workerId < cfg->slowWorkers) {
+        us += static_cast<long long>((cfg->slowFactor - 1) * workUs);
+    }
+
+    delayedUs_ += us;
+    return us;
+}
+
+long long FaultInjector::stallUs() {
+    if (!enabled_.load(std::memory_order_relaxed)) return 0;
+
+    std::shared_ptr<const Config> cfg;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        cfg = cfg_;
+    }
+    if (cfg->stallRate <= 0 || uniform01() >= cfg->stallRate) return 0;
+
+    const long long us = static_cast<long long>(cfg->stallMs) * 1000;
+    stalls_++;
+    delayedUs_ += us;
+    return us;
+}
+
+void FaultInjector::fill(ocr::ServerStats* out) const {
+    out->set_faults(spec());
+    out->set_injected_failures(failures_.load());
+    out->set_injected_stalls(stalls_.load());
+    out->set_injected_delay_ms(delayedUs_.load() / 1000);
+}
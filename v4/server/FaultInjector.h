@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ocr.pb.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Latency and failures injected on purpose, to see how clients cope with
+// timeouts, retries, hedging and backpressure under a realistic tail.
+// Off unless configured with a spec (--faults, or the SetFaults RPC):
+//
+//   delay=fixed:MS | uniform:MIN-MAX | exp:MEAN | lognormal:MEDIAN:SIGMA
+//                        extra time per job, in ms
+//   fail=P               fail this fraction of requests (UNAVAILABLE)
+//   stall=P              hang this fraction of jobs for stall-ms (30000)
+//                        with an engine checked out, as a wedged engine
+//                        would: other jobs needing one of its settings
+//                        wait for it too. A delay only holds the worker,
+//                        after its engine is back in the pool
+//   slow-workers=N       workers 0..N-1 take slow-factor (4) times as
+//                        long as the job really did
+//
+// e.g. "delay=lognormal:50:1,fail=0.01,slow-workers=1". "" or "off" = none.
+// Times are at most 10 minutes and counts whole numbers; anything else
+// is rejected, as the spec may come from any client.
+class FaultInjector {
+public:
+    struct Config {
+        enum class Delay { None, Fixed, Uniform, Exponential, LogNormal };
+        Delay delay = Delay::None;
+        double delayA = 0;          // fixed / min / mean / median, ms
+        double delayB = 0;          // max (uniform) or sigma (lognormal)
+
+        double failRate = 0;
+        double stallRate = 0;
+        int stallMs = 30000;
+        int slowWorkers = 0;
+        double slowFactor = 4;
+
+        bool any() const;
+    };
+
+    // false (and error set) if the spec doesn't parse
+    static bool parse(const std::string& spec, Config& out, std::string& error);
+
+    // canonical spec, as parse() accepts it
+    static std::string format(const Config& cfg);
+
+    void set(const Config& cfg);
+    std::string spec() const;
+
+    // at the start of a request: true if it should fail
+    bool shouldFail();
+
+    // after a worker spent workUs on a job: how long to hold it back
+    long long workerDelayUs(int workerId, long long workUs);
+
+    // before a job is recognized: how long it should sit on its engine
+    // (0 for nearly every job)
+    long long stallUs();
+
+    void fill(ocr::ServerStats* out) const;
+
+private:
+    static double uniform01();
+
+    // checked first, so the default (off) costs one relaxed load per job
+    std::atomic<bool> enabled_{false};
+    mutable std::mutex mtx_;
+    std::shared_ptr<const Config> cfg_ = std::make_shared<Config>();
+
+    std::atomic<long long> failures_{0};
+    std::atomic<long long> stalls_{0};
+    std::atomic<long long> delayedUs_{0};
+};
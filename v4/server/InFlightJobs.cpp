@@ -0,0 +1,16 @@
+#include "InFlightJobs.h"
+
+bool InFlightJobs::joinOrLead(const std::string& key,
+                              std::shared_future<OcrResult>& result) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto [it, inserted] = jobs_.try_emplace(key, result);
+    if (inserted) return false;
+
+    result = it->second;
+    return true;
+}
+
+void InFlightJobs::finish(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    jobs_.erase(key);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "OcrJob.h"
+
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Jobs queued or running, by content hash + settings (ResultCache::key),
+// so identical requests arriving together share one OCR run: the first
+// becomes the leader and queues the job, the rest wait on its result.
+class InFlightJobs {
+public:
+    // Registers result under key and returns false, or returns true with
+    // the leader's future in result if the key is already in flight.
+    bool joinOrLead(const std::string& key, std::shared_future<OcrResult>& result);
+
+    // the leader is done with key (after caching its result)
+    void finish(const std::string& key);
+
+private:
+    std::mutex mtx_;
+    std::unordered_map<std::string, std::shared_future<OcrResult>> jobs_;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "OcrJob.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Pending jobs shared by all workers. With shortestFirst, jobs are taken
+// in order of arrival time + expected cost, so a label arriving behind a
+// big scan overtakes it, but only by as much as the scan is expected to
+// take: a job can't be passed by anything arriving more than its own
+// expected cost after it, so large jobs are never starved. Without it (or
+// when costs are 0) this is plain FIFO.
+class JobQueue {
+public:
+    explicit JobQueue(bool shortestFirst = false) : shortestFirst_(shortestFirst) {}
+
+    // returns the expected cost of the work queued before this job (its
+    // own not included). Exact for FIFO; with shortestFirst only an
+    // estimate, since some of it may run after this job and cheaper jobs
+    // arriving later go ahead of it. Summing only what sorts ahead would
+    // cost a walk of the queue per push, under the lock every worker takes
+    long long push(OcrJob job) {
+        long long ahead = 0;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+
+            Entry entry;
+            entry.key = nowUs() + (shortestFirst_ ? job.expectedCostUs : 0);
+            entry.seq = nextSeq_++;
+            entry.job = std::move(job);
+
+            ahead = queuedCostUs_;
+            heap_.push_back(std::move(entry));
+            std::push_heap(heap_.begin(), heap_.end(), later);
+            queuedCostUs_ += heap_.back().job.expectedCostUs;
+        }
+        cv_.notify_one();
+        return ahead;
+    }
+
+    // jump the line, for work that someone is already waiting on
+    void pushFront(OcrJob job) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            queuedCostUs_ += job.expectedCostUs;
+            urgent_.push_front(std::move(job));
+        }
+        cv_.notify_one();
+    }
+
+    // blocks until a job is available; returns nothing once stopped and drained
+    std::optional<OcrJob> pop() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait(lock, [&]{ return !urgent_.empty() || !heap_.empty() || !running_; });
+
+        if (!urgent_.empty()) {
+            OcrJob job = std::move(urgent_.front());
+            urgent_.pop_front();
+            queuedCostUs_ -= job.expectedCostUs;
+            return job;
+        }
+        if (heap_.empty()) {
+            return std::nullopt;
+        }
+
+        std::pop_heap(heap_.begin(), heap_.end(), later);
+        OcrJob job = std::move(heap_.back().job);
+        heap_.pop_back();
+        queuedCostUs_ -= job.expectedCostUs;
+        return job;
+    }
+
+    // expected cost of everything waiting
+    long long queuedCostUs() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return queuedCostUs_;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            running_ = false;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    struct Entry {
+        long long key = 0;      // run order, smallest first
+        uint64_t seq = 0;       // FIFO among equal keys
+        OcrJob job;
+    };
+
+    // heap comparator: true if a runs after b
+    static bool later(const Entry& a, const Entry& b) {
+        return a.key != b.key ? a.key > b.key : a.seq > b.seq;
+    }
+
+    static long long nowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool shortestFirst_;
+    std::vector<Entry> heap_;
+    std::deque<OcrJob> urgent_;
+    uint64_t nextSeq_ = 0;
+    long long queuedCostUs_ = 0;
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::atomic<bool> running_{true};
+};
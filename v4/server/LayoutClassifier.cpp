@@ -0,0 +1,123 @@
+#include "LayoutClassifier.h"
+
+#include <algorithm>
+#include <vector>
+
+// anything taller is assumed to be a page, not a strip
+static constexpr int kMaxStripHeight = 600;
+
+// strips are clearly wider than tall
+static constexpr double kMinStripAspect = 1.5;
+
+const char* layoutClassName(LayoutClass c) {
+    switch (c) {
+        case LayoutClass::SingleWord: return "single_word";
+        case LayoutClass::SingleLine: return "single_line";
+        case LayoutClass::MultiLine:  return "multi_line";
+    }
+    return "unknown";
+}
+
+tesseract::PageSegMode layoutPageSegMode(LayoutClass c) {
+    switch (c) {
+        case LayoutClass::SingleWord: return tesseract::PSM_SINGLE_WORD;
+        case LayoutClass::SingleLine: return tesseract::PSM_SINGLE_LINE;
+        case LayoutClass::MultiLine:  return tesseract::PSM_AUTO;
+    }
+    return tesseract::PSM_AUTO;
+}
+
+LayoutClass classifyLayout(PIX* pix) {
+    if (!pix) return LayoutClass::MultiLine;
+
+    const int w = pixGetWidth(pix);
+    const int h = pixGetHeight(pix);
+    if (h <= 0 || w <= 0) return LayoutClass::MultiLine;
+    if (h > kMaxStripHeight) return LayoutClass::MultiLine;
+
+    PIX* gray = pixConvertTo8(pix, 0);
+    if (!gray) return LayoutClass::MultiLine;
+
+    const l_uint32* data = pixGetData(gray);
+    const int wpl = pixGetWpl(gray);
+
+    // global mean decides what counts as ink; dark text on light background
+    // is the common case, flip the test if most of the image is dark
+    long long sum = 0;
+    for (int y = 0; y < h; y++) {
+        const l_uint32* line = data + y * wpl;
+        for (int x = 0; x < w; x++) sum += GET_DATA_BYTE(line, x);
+    }
+    const int mean = static_cast<int>(sum / (static_cast<long long>(w) * h));
+    const bool lightText = mean < 128;
+    const int threshold = lightText ? (mean + 255) / 2 : mean / 2;
+
+    auto isInk = [&](int v) { return lightText ? v > threshold : v < threshold; };
+
+    std::vector<int> rowInk(h, 0);
+    for (int y = 0; y < h; y++) {
+        const l_uint32* line = data + y * wpl;
+        int n = 0;
+        for (int x = 0; x < w; x++) n += isInk(GET_DATA_BYTE(line, x));
+        rowInk[y] = n;
+    }
+
+    // rows with only a few specks of noise are not text
+    const int maxRow = *std::max_element(rowInk.begin(), rowInk.end());
+    const int rowMin = std::max(2, maxRow / 20);
+
+    struct Band { int top; int bottom; };
+    std::vector<Band> bands;
+    for (int y = 0; y < h; ) {
+        if (rowInk[y] < rowMin) { y++; continue; }
+        int top = y;
+        while (y < h && rowInk[y] >= rowMin) y++;
+        bands.push_back({top, y});
+    }
+
+    int tallest = 0;
+    for (const Band& b : bands) tallest = std::max(tallest, b.bottom - b.top);
+
+    // ignore bands that are a sliver of the tallest one (underlines, dirt)
+    std::vector<Band> lines;
+    for (const Band& b : bands) {
+        if (b.bottom - b.top >= std::max(3, tallest / 5)) lines.push_back(b);
+    }
+
+    LayoutClass result = LayoutClass::MultiLine;
+
+    const bool stripShaped = static_cast<double>(w) / h >= kMinStripAspect;
+
+    if (lines.size() == 1 && stripShaped) {
+        // one text line: a blank column run wider than ~1/3 of the line
+        // height between ink columns is a word gap
+        const Band& band = lines.front();
+        const int lineHeight = band.bottom - band.top;
+        const int minGap = std::max(3, lineHeight / 3);
+
+        int gaps = 0;
+        int blankRun = 0;
+        bool seenInk = false;
+        for (int x = 0; x < w; x++) {
+            int n = 0;
+            for (int y = band.top; y < band.bottom; y++) {
+                n += isInk(GET_DATA_BYTE(data + y * wpl, x));
+            }
+            if (n >= 2) {
+                if (seenInk && blankRun >= minGap) gaps++;
+                seenInk = true;
+                blankRun = 0;
+            } else {
+                blankRun++;
+            }
+        }
+        result = gaps == 0 ? LayoutClass::SingleWord : LayoutClass::SingleLine;
+    }
+    else if (lines.empty() && stripShaped) {
+        // nothing that looks like text; a line engine copes with blank strips
+        result = LayoutClass::SingleLine;
+    }
+
+    pixDestroy(&gray);
+    return result;
+}
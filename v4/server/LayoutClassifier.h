@@ -0,0 +1,24 @@
+#pragma once
+
+#include <leptonica/allheaders.h>
+
+#include <tesseract/publictypes.h>
+
+// coarse guess at how much layout analysis an image needs
+enum class LayoutClass {
+    SingleWord,
+    SingleLine,
+    MultiLine,
+};
+
+const char* layoutClassName(LayoutClass c);
+
+// page segmentation mode the class is routed to
+tesseract::PageSegMode layoutPageSegMode(LayoutClass c);
+
+// Looks at aspect ratio, height and a horizontal projection profile
+// (dark pixels per row) to count text lines; a single line is split into
+// word/line by looking for wide blank column runs. Costs one gray
+// conversion and a pass over the pixels, far less than PSM_AUTO's layout
+// analysis. Tall images are treated as pages without looking further.
+LayoutClass classifyLayout(PIX* pix);
@@ -0,0 +1,162 @@
+#include "MicroBatch.h"
+
+#include <algorithm>
+
+// blank rows between strips (at least this, or half the tallest strip),
+// so Tesseract never merges lines from two images
+static constexpr int kMinGap = 16;
+static constexpr int kMargin = 8;
+
+// ---- CompositePage ----
+
+CompositePage::~CompositePage() {
+    pixDestroy(&pix_);
+}
+
+bool CompositePage::build(const std::vector<PIX*>& strips) {
+    pixDestroy(&pix_);
+    placements_.clear();
+    if (strips.empty()) return false;
+
+    int width = 0;
+    int tallest = 0;
+    for (PIX* s : strips) {
+        width = std::max(width, pixGetWidth(s));
+        tallest = std::max(tallest, pixGetHeight(s));
+    }
+    const int gap = std::max(kMinGap, tallest / 2);
+
+    int height = kMargin;
+    for (PIX* s : strips) {
+        PixRegion r;
+        r.x = kMargin;
+        r.y = height;
+        r.w = pixGetWidth(s);
+        r.h = pixGetHeight(s);
+        placements_.push_back(r);
+        height += r.h + gap;
+    }
+    height += kMargin - gap;
+
+    pix_ = pixCreate(width + 2 * kMargin, height, 8);
+    if (!pix_) return false;
+    pixSetAll(pix_);    // white
+
+    for (size_t i = 0; i < strips.size(); i++) {
+        PIX* gray = pixConvertTo8(strips[i], 0);
+        if (!gray) {
+            pixDestroy(&pix_);
+            return false;
+        }
+        const PixRegion& r = placements_[i];
+        pixRasterop(pix_, r.x, r.y, r.w, r.h, PIX_SRC, gray, 0, 0);
+        pixDestroy(&gray);
+    }
+    return true;
+}
+
+void CompositePage::split(const std::vector<TextSegment>& lines,
+                          std::vector<std::string>& texts,
+                          std::vector<int>& confidences) const {
+    const size_t n = placements_.size();
+    texts.assign(n, std::string());
+    confidences.assign(n, 0);
+    std::vector<int> lineCount(n, 0);
+
+    for (const TextSegment& line : lines) {
+        const int cy = line.box.y + line.box.h / 2;
+        for (size_t i = 0; i < n; i++) {
+            const PixRegion& r = placements_[i];
+            if (cy < r.y || cy >= r.y + r.h) continue;
+
+            texts[i] += line.text;
+            if (!texts[i].empty() && texts[i].back() != '\n') texts[i] += '\n';
+            confidences[i] += line.confidence;
+            lineCount[i]++;
+            break;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (lineCount[i] > 0) confidences[i] /= lineCount[i];
+    }
+}
+
+bool isSmallImage(std::string_view data, int maxWidth, int maxHeight) {
+    l_int32 format = 0, w = 0, h = 0, bps = 0, spp = 0, cmap = 0;
+    if (pixReadHeaderMem((const l_uint8*)data.data(), data.size(),
+                         &format, &w, &h, &bps, &spp, &cmap) != 0) {
+        return false;
+    }
+    return w > 0 && h > 0 && w <= maxWidth && h <= maxHeight;
+}
+
+// ---- MicroBatcher ----
+
+MicroBatcher::MicroBatcher(int windowMs, int maxBatch, Flush flush)
+    : window_(windowMs),
+      maxBatch_(static_cast<size_t>(std::max(1, maxBatch))),
+      flush_(std::move(flush))
+{
+    timer_ = std::thread(&MicroBatcher::timerLoop, this);
+}
+
+MicroBatcher::~MicroBatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    timer_.join();
+}
+
+void MicroBatcher::add(OcrJob job, const std::string& settings) {
+    std::vector<OcrJob> full;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        Group& group = groups_[settings];
+        if (group.jobs.empty()) {
+            group.deadline = std::chrono::steady_clock::now() + window_;
+            cv_.notify_one();
+        }
+        group.jobs.push_back(std::move(job));
+
+        if (group.jobs.size() >= maxBatch_) {
+            full.swap(group.jobs);
+            groups_.erase(settings);
+        }
+    }
+    if (!full.empty()) flush_(std::move(full));
+}
+
+void MicroBatcher::timerLoop() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    for (;;) {
+        auto now = std::chrono::steady_clock::now();
+
+        std::vector<std::vector<OcrJob>> due;
+        auto next = std::chrono::steady_clock::time_point::max();
+        for (auto it = groups_.begin(); it != groups_.end();) {
+            if (stopping_ || it->second.deadline <= now) {
+                due.push_back(std::move(it->second.jobs));
+                it = groups_.erase(it);
+            } else {
+                next = std::min(next, it->second.deadline);
+                ++it;
+            }
+        }
+
+        if (!due.empty()) {
+            lock.unlock();
+            for (auto& jobs : due) flush_(std::move(jobs));
+            lock.lock();
+            continue;
+        }
+        if (stopping_) return;
+
+        if (next == std::chrono::steady_clock::time_point::max()) {
+            cv_.wait(lock);
+        } else {
+            cv_.wait_until(lock, next);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "OcrJob.h"
+
+#include <leptonica/allheaders.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Small strips stacked into one page, so Tesseract's fixed per-call cost
+// (SetImage, page setup, layout) is paid once for many images. Strips are
+// placed one below another with blank rows between them; the page's text
+// lines are then handed back to whichever strip they fall in.
+class CompositePage {
+public:
+    CompositePage() = default;
+    ~CompositePage();
+
+    CompositePage(const CompositePage&) = delete;
+    CompositePage& operator=(const CompositePage&) = delete;
+
+    // strips may be any depth; the page is 8-bit gray
+    bool build(const std::vector<PIX*>& strips);
+
+    PIX* pix() const { return pix_; }
+    const std::vector<PixRegion>& placements() const { return placements_; }
+
+    // Text and mean confidence per strip, from the page's text lines (in
+    // page coordinates). A line belongs to the strip its centre is in.
+    void split(const std::vector<TextSegment>& lines,
+               std::vector<std::string>& texts,
+               std::vector<int>& confidences) const;
+
+private:
+    PIX* pix_ = nullptr;
+    std::vector<PixRegion> placements_;
+};
+
+// true if the encoded image's header says it is no bigger than the limits
+bool isSmallImage(std::string_view data, int maxWidth, int maxHeight);
+
+// Holds small jobs for up to windowMs and hands them over in groups of
+// jobs with the same settings, at most maxBatch at a time, whichever
+// comes first.
+class MicroBatcher {
+public:
+    using Flush = std::function<void(std::vector<OcrJob>)>;
+
+    MicroBatcher(int windowMs, int maxBatch, Flush flush);
+    ~MicroBatcher();    // flushes whatever is still held
+
+    MicroBatcher(const MicroBatcher&) = delete;
+    MicroBatcher& operator=(const MicroBatcher&) = delete;
+
+    void add(OcrJob job, const std::string& settings);
+
+private:
+    struct Group {
+        std::vector<OcrJob> jobs;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void timerLoop();
+
+    std::chrono::milliseconds window_;
+    size_t maxBatch_;
+    Flush flush_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::map<std::string, Group> groups_;
+    bool stopping_ = false;
+    std::thread timer_;
+};
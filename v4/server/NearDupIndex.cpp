@@ -0,0 +1,52 @@
+#include "NearDupIndex.h"
+
+NearDupIndex::NearDupIndex(int maxDistance, size_t capacity)
+    : maxDistance_(maxDistance), capacity_(capacity)
+{}
+
+bool NearDupIndex::find(const PerceptualHash& hash, const std::string& settings,
+                        OcrResult& out, int& distance) {
+    if (!enabled()) return false;
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    lookups_++;
+
+    const Entry* best = nullptr;
+    int bestDistance = maxDistance_ + 1;
+    for (const Entry& e : entries_) {
+        int d = e.hash.distance(hash);
+        if (d < bestDistance && e.settings == settings && e.hash.similarShape(hash)) {
+            best = &e;
+            bestDistance = d;
+        }
+    }
+    if (!best) return false;
+
+    out = best->result;
+    distance = bestDistance;
+    hits_++;
+    return true;
+}
+
+void NearDupIndex::add(const PerceptualHash& hash, const std::string& settings,
+                       const OcrResult& result) {
+    if (!enabled() || !result.success) return;
+
+    Entry entry{hash, settings, result};
+    entry.result.segments.clear();
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (entries_.size() < capacity_) {
+        entries_.push_back(std::move(entry));
+        return;
+    }
+    entries_[next_] = std::move(entry);
+    next_ = (next_ + 1) % capacity_;
+}
+
+void NearDupIndex::fill(ocr::ServerStats* out) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    out->set_near_dup_lookups(lookups_);
+    out->set_near_dup_hits(hits_);
+    out->set_near_dup_entries(static_cast<long long>(entries_.size()));
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "OcrJob.h"
+#include "PerceptualHash.h"
+#include "ocr.pb.h"
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Recent results by perceptual hash, so a re-scan or recompressed copy of
+// an image already recognized gets the earlier text instead of another OCR
+// pass. Unlike ResultCache this is a guess: a match only means the pages
+// look alike, which is why it is off by default and hits are flagged.
+//
+// Lookups scan every entry (a few popcounts each), which stays in the
+// microseconds for the few thousand entries kept; the oldest entry is
+// replaced once the index is full.
+class NearDupIndex {
+public:
+    // maxDistance < 0 disables the index
+    NearDupIndex(int maxDistance, size_t capacity);
+
+    bool enabled() const { return maxDistance_ >= 0 && capacity_ > 0; }
+
+    // closest entry within maxDistance bits that was recognized with the
+    // same settings and has about the same shape
+    bool find(const PerceptualHash& hash, const std::string& settings,
+              OcrResult& out, int& distance);
+    void add(const PerceptualHash& hash, const std::string& settings,
+             const OcrResult& result);
+
+    void fill(ocr::ServerStats* out);
+
+private:
+    struct Entry {
+        PerceptualHash hash;
+        std::string settings;
+        OcrResult result;
+    };
+
+    int maxDistance_;
+    size_t capacity_;
+
+    std::mutex mtx_;
+    std::vector<Entry> entries_;
+    size_t next_ = 0;           // slot the next add() overwrites once full
+    long long lookups_ = 0;
+    long long hits_ = 0;
+};
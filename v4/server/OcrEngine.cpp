@@ -0,0 +1,183 @@
+#include "OcrEngine.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+const char* modelTierName(ModelTier tier) {
+    switch (tier) {
+        case ModelTier::Standard: return "standard";
+        case ModelTier::Fast:     return "fast";
+        case ModelTier::Best:     return "best";
+    }
+    return "unknown";
+}
+
+std::string EngineConfig::key() const {
+    return language
+         + "|" + modelTierName(tier)
+         + "|psm" + std::to_string(static_cast<int>(psm))
+         + "|oem" + std::to_string(static_cast<int>(oem))
+         + (whitelist.empty() ? "" : "|wl:" + whitelist);
+}
+
+std::string resolveTessdataDir() {
+    const char* env = std::getenv("TESSDATA_PREFIX");
+
+    if (env && std::strlen(env) > 0) {
+        return env;
+    } 
+
+    // Apple Silicon Homebrew
+    if (std::filesystem::exists("/opt/homebrew/share/tessdata/eng.traineddata")) {
+        return "/opt/homebrew/share/tessdata";
+    }
+    // Intel Homebrew 
+    if (std::filesystem::exists("/usr/local/share/tessdata/eng.traineddata")) {
+        return "/usr/local/share/tessdata";
+    }
+    // Apple Homebrew Cellar 
+    if (std::filesystem::exists("/opt/homebrew/opt/tesseract/share/tessdata/eng.traineddata")) {
+        return "/opt/homebrew/opt/tesseract/share/tessdata";
+    }
+    // Intel Cellar 
+    if (std::filesystem::exists("/usr/local/Cellar/tesseract/5.5.1_1/share/tessdata/eng.traineddata")) {
+        return "/usr/local/Cellar/tesseract/5.5.1_1/share/tessdata";
+    }
+    return ".";  
+}
+
+OcrEngine::OcrEngine()
+    : OcrEngine(EngineConfig{}, resolveTessdataDir())
+{}
+
+OcrEngine::OcrEngine(const EngineConfig& config, const std::string& tessdataDir)
+    : config_(config)
+{
+    int rc = tess_.Init(tessdataDir.c_str(), config_.language.c_str(), config_.oem);
+    if (rc != 0) {
+        std::cerr << "[OCR] Failed to initialize Tesseract for "
+                  << config_.key() << ".\n";
+        initialized_ = false;
+        return;
+    }
+
+    tess_.SetPageSegMode(config_.psm);
+    if (!config_.whitelist.empty()) {
+        tess_.SetVariable("tessedit_char_whitelist", config_.whitelist.c_str());
+    }
+    initialized_ = true;
+}
+
+OcrEngine::~OcrEngine() {
+    if (initialized_) tess_.End();
+}
+
+bool OcrEngine::recognize(const std::string &img, std::string &out, long long &ms) {
+    if (!initialized_) return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    PIX* pix = pixReadMem((l_uint8*)img.data(), img.size());
+    if (!pix) return false;
+
+    long long recognizeMs = 0;
+    bool ok = recognize(pix, out, recognizeMs);
+    pixDestroy(&pix);
+
+    auto end = std::chrono::steady_clock::now();
+    ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    return ok;
+}
+
+bool OcrEngine::recognize(PIX* pix, std::string &out, long long &ms,
+                          const PixRegion* region) {
+    if (!initialized_ || !pix) return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    tess_.SetImage(pix);
+    if (region) {
+        tess_.SetRectangle(region->x, region->y, region->w, region->h);
+    }
+    char* raw = tess_.GetUTF8Text();
+    lastConfidence_ = raw ? tess_.MeanTextConf() : 0;
+
+    auto end = std::chrono::steady_clock::now();
+    ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    if (raw) {
+        out = raw;
+        delete[] raw;
+        return true;
+    }
+    return false;
+}
+
+bool OcrEngine::recognizeSegments(PIX* pix, const PixRegion* region,
+                                  tesseract::PageIteratorLevel level,
+                                  std::vector<TextSegment> &segments,
+                                  std::string &out) {
+    if (!initialized_ || !pix) return false;
+
+    tess_.SetImage(pix);
+    if (region) {
+        tess_.SetRectangle(region->x, region->y, region->w, region->h);
+    }
+    if (tess_.Recognize(nullptr) != 0) return false;
+
+    // boxes come back in full-image coordinates, also with a rectangle set
+    tesseract::ResultIterator* it = tess_.GetIterator();
+    if (it && !it->Empty(level)) {
+        do {
+            char* raw = it->GetUTF8Text(level);
+            if (!raw) continue;
+
+            TextSegment seg;
+            seg.text = raw;
+            delete[] raw;
+            seg.confidence = static_cast<int>(it->Confidence(level));
+
+            int right = 0, bottom = 0;
+            it->BoundingBox(level, &seg.box.x, &seg.box.y, &right, &bottom);
+            seg.box.w = right - seg.box.x;
+            seg.box.h = bottom - seg.box.y;
+
+            segments.push_back(std::move(seg));
+        } while (it->Next(level));
+    }
+    delete it;
+
+    // already recognized, so this only assembles the text
+    char* raw = tess_.GetUTF8Text();
+    lastConfidence_ = raw ? tess_.MeanTextConf() : 0;
+    if (!raw) return false;
+
+    out = raw;
+    delete[] raw;
+    return true;
+}
+
+std::vector<PixRegion> OcrEngine::layoutBlocks(PIX* pix) {
+    std::vector<PixRegion> blocks;
+    if (!initialized_ || !pix) return blocks;
+
+    tess_.SetImage(pix);
+    Boxa* boxes = tess_.GetComponentImages(tesseract::RIL_BLOCK, true, nullptr, nullptr);
+    if (!boxes) return blocks;
+
+    const int n = boxaGetCount(boxes);
+    for (int i = 0; i < n; i++) {
+        Box* box = boxaGetBox(boxes, i, L_CLONE);
+        if (!box) continue;
+
+        PixRegion r;
+        boxGetGeometry(box, &r.x, &r.y, &r.w, &r.h);
+        if (r.w > 0 && r.h > 0) blocks.push_back(r);
+        boxDestroy(&box);
+    }
+    boxaDestroy(&boxes);
+    return blocks;
+}
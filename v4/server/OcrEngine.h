@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <tesseract/baseapi.h>
+#include <leptonica/allheaders.h>
+
+// which set of traineddata models an engine loads
+enum class ModelTier {
+    Standard,   // the regular tessdata folder
+    Fast,       // tessdata_fast: integer LSTM, much cheaper, a bit less accurate
+    Best,       // tessdata_best: float LSTM, slowest, most accurate
+};
+
+const char* modelTierName(ModelTier tier);
+
+// everything that needs a separate Init()'d Tesseract instance
+struct EngineConfig {
+    std::string language = "eng";
+    ModelTier tier = ModelTier::Standard;
+    tesseract::PageSegMode psm = tesseract::PSM_AUTO;
+    tesseract::OcrEngineMode oem = tesseract::OEM_DEFAULT;
+    std::string whitelist;
+
+    // identifies the engine pool this config is served from
+    std::string key() const;
+};
+
+// rectangle inside an image, in pixels
+struct PixRegion {
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+};
+
+// one block or line of recognized text, with where it was found
+struct TextSegment {
+    std::string text;
+    int confidence = 0;
+    PixRegion box;
+};
+
+// finds the tessdata folder: TESSDATA_PREFIX, then the usual Homebrew paths
+std::string resolveTessdataDir();
+
+// one Tesseract instance; not thread-safe, so only one job uses it at a time
+class OcrEngine {
+public:
+    OcrEngine();
+    OcrEngine(const EngineConfig& config, const std::string& tessdataDir);
+    ~OcrEngine();
+
+    OcrEngine(const OcrEngine&) = delete;
+    OcrEngine& operator=(const OcrEngine&) = delete;
+
+    bool initialized() const { return initialized_; }
+    const EngineConfig& config() const { return config_; }
+
+    // img: encoded PNG/JPEG bytes
+    bool recognize(const std::string &img, std::string &out, long long &ms);
+
+    // same, for an image the caller already decoded (pix is not destroyed);
+    // with a region only that rectangle is recognized
+    bool recognize(PIX* pix, std::string &out, long long &ms,
+                   const PixRegion* region = nullptr);
+
+    // recognize(), but also splits the result into blocks or lines
+    // (level) with their confidence and position in the full image
+    bool recognizeSegments(PIX* pix, const PixRegion* region,
+                           tesseract::PageIteratorLevel level,
+                           std::vector<TextSegment> &segments,
+                           std::string &out);
+
+    // text blocks from Tesseract's layout analysis, in its reading order;
+    // needs an engine whose page segmentation mode does layout (PSM_AUTO)
+    std::vector<PixRegion> layoutBlocks(PIX* pix);
+
+    // Tesseract's mean word confidence (0-100) for the last recognize()
+    int lastConfidence() const { return lastConfidence_; }
+
+private:
+    EngineConfig config_;
+    tesseract::TessBaseAPI tess_;
+    bool initialized_ = false;
+    int lastConfidence_ = 0;
+};
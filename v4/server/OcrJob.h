@@ -0,0 +1,83 @@
+#pragma once
+
+#include "CostModel.h"
+#include "OcrEngine.h"
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// worker-side stage times, in microseconds since OcrJob::receivedAt
+struct StageTimes {
+    long long dequeuedUs = 0;
+    long long decodedUs = 0;
+    long long recognizedUs = 0;
+    long long delayDoneUs = 0;
+    int workerId = -1;
+};
+
+// outcome of one OCR job, handed back to the waiting RPC thread
+struct OcrResult {
+    std::string text;
+    bool success = false;
+    std::string error;
+    long long ms = 0;
+    tesseract::PageSegMode psm = tesseract::PSM_AUTO;
+    ModelTier tier = ModelTier::Standard;
+    int confidence = 0;
+    bool escalated = false;
+
+    // text taken from a near-duplicate image (NearDupIndex)
+    bool nearDuplicate = false;
+    int nearDuplicateDistance = 0;
+
+    // filled only for streaming requests
+    std::vector<TextSegment> segments;
+
+    StageTimes stages;
+};
+
+// holds all data needed for processing one image
+struct OcrJob {
+    int batchId = 0;
+    int index = 0;
+    std::string filename;
+    std::chrono::steady_clock::time_point receivedAt;   // RPC arrival
+    // the request's bytes or a shared-memory slot, read in place; only valid
+    // until the RPC that queued the job returns, which waits for it
+    std::string_view imageData;
+    std::shared_ptr<const void> imageOwner;     // keeps a slot's mapping alive
+    EngineConfig config;
+
+    // CostModel inputs and its prediction, which orders the queue
+    CostModel::Features costFeatures;
+    long long expectedCostUs = 0;
+
+    // content hash + settings, for ResultCache and InFlightJobs; empty
+    // when both are off
+    std::string cacheKey;
+
+    // the layout classifier may pick the page segmentation mode;
+    // false when the request pinned a mode or profile itself
+    bool autoLayout = false;
+
+    // the server may run the fast-first cascade; false when the request
+    // asked for a specific model tier
+    bool autoTier = false;
+
+    // streaming requests: called with each block/line (segmentLevel) in
+    // reading order as soon as it is final, from a worker thread
+    std::function<void(const TextSegment&)> onSegment;
+    tesseract::PageIteratorLevel segmentLevel = tesseract::RIL_TEXTLINE;
+
+    // fulfilled by the worker once the job has been processed
+    std::shared_ptr<std::promise<OcrResult>> done;
+
+    // internal work item (e.g. helping with a split page); when set the
+    // worker just runs it instead of treating this as an image
+    std::function<void()> task;
+};
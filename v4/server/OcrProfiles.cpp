@@ -0,0 +1,136 @@
+#include "OcrProfiles.h"
+
+#include <cctype>
+
+namespace {
+
+struct Profile {
+    const char* name;
+    tesseract::PageSegMode psm;
+};
+
+const Profile kProfiles[] = {
+    {"default", tesseract::PSM_AUTO},
+    {"block",   tesseract::PSM_SINGLE_BLOCK},
+    {"line",    tesseract::PSM_SINGLE_LINE},
+    {"word",    tesseract::PSM_SINGLE_WORD},
+    {"sparse",  tesseract::PSM_SPARSE_TEXT},
+};
+
+bool toTesseract(ocr::PageSegMode mode, tesseract::PageSegMode& out) {
+    switch (mode) {
+        case ocr::PAGE_SEG_AUTO:         out = tesseract::PSM_AUTO; return true;
+        case ocr::PAGE_SEG_SINGLE_BLOCK: out = tesseract::PSM_SINGLE_BLOCK; return true;
+        case ocr::PAGE_SEG_SINGLE_LINE:  out = tesseract::PSM_SINGLE_LINE; return true;
+        case ocr::PAGE_SEG_SINGLE_WORD:  out = tesseract::PSM_SINGLE_WORD; return true;
+        case ocr::PAGE_SEG_SPARSE_TEXT:  out = tesseract::PSM_SPARSE_TEXT; return true;
+        case ocr::PAGE_SEG_RAW_LINE:     out = tesseract::PSM_RAW_LINE; return true;
+        default: return false;
+    }
+}
+
+bool toTesseract(ocr::EngineMode mode, tesseract::OcrEngineMode& out) {
+    switch (mode) {
+        case ocr::ENGINE_LSTM_ONLY:   out = tesseract::OEM_LSTM_ONLY; return true;
+        case ocr::ENGINE_LEGACY_ONLY: out = tesseract::OEM_TESSERACT_ONLY; return true;
+        case ocr::ENGINE_LEGACY_LSTM: out = tesseract::OEM_TESSERACT_LSTM_COMBINED; return true;
+        default: return false;
+    }
+}
+
+// language codes become traineddata file names, so keep them to [A-Za-z0-9_+]
+bool validLanguage(const std::string& lang) {
+    if (lang.empty() || lang.size() > 64) return false;
+    for (unsigned char c : lang) {
+        if (!std::isalnum(c) && c != '_' && c != '+') return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool profileConfig(const std::string& name, EngineConfig& out) {
+    for (const Profile& p : kProfiles) {
+        if (name == p.name) {
+            out = EngineConfig{};
+            out.psm = p.psm;
+            return true;
+        }
+    }
+    return false;
+}
+
+ocr::ModelTier toProtoModelTier(ModelTier tier) {
+    switch (tier) {
+        case ModelTier::Standard: return ocr::MODEL_TIER_STANDARD;
+        case ModelTier::Fast:     return ocr::MODEL_TIER_FAST;
+        case ModelTier::Best:     return ocr::MODEL_TIER_BEST;
+    }
+    return ocr::MODEL_TIER_DEFAULT;
+}
+
+ocr::PageSegMode toProtoPageSegMode(tesseract::PageSegMode psm) {
+    switch (psm) {
+        case tesseract::PSM_AUTO:         return ocr::PAGE_SEG_AUTO;
+        case tesseract::PSM_SINGLE_BLOCK: return ocr::PAGE_SEG_SINGLE_BLOCK;
+        case tesseract::PSM_SINGLE_LINE:  return ocr::PAGE_SEG_SINGLE_LINE;
+        case tesseract::PSM_SINGLE_WORD:  return ocr::PAGE_SEG_SINGLE_WORD;
+        case tesseract::PSM_SPARSE_TEXT:  return ocr::PAGE_SEG_SPARSE_TEXT;
+        case tesseract::PSM_RAW_LINE:     return ocr::PAGE_SEG_RAW_LINE;
+        default:                          return ocr::PAGE_SEG_DEFAULT;
+    }
+}
+
+std::vector<std::string> profileNames() {
+    std::vector<std::string> names;
+    for (const Profile& p : kProfiles) names.push_back(p.name);
+    return names;
+}
+
+bool resolveEngineConfig(const ocr::OcrOptions& options,
+                         EngineConfig& out,
+                         std::string& error)
+{
+    const std::string profile = options.profile().empty() ? "default" : options.profile();
+    if (!profileConfig(profile, out)) {
+        error = "unknown profile: " + profile;
+        return false;
+    }
+
+    if (options.page_seg_mode() != ocr::PAGE_SEG_DEFAULT &&
+        !toTesseract(options.page_seg_mode(), out.psm)) {
+        error = "unsupported page_seg_mode";
+        return false;
+    }
+
+    if (options.engine_mode() != ocr::ENGINE_DEFAULT &&
+        !toTesseract(options.engine_mode(), out.oem)) {
+        error = "unsupported engine_mode";
+        return false;
+    }
+
+    if (!options.language().empty()) {
+        if (!validLanguage(options.language())) {
+            error = "invalid language: " + options.language();
+            return false;
+        }
+        out.language = options.language();
+    }
+
+    switch (options.model_tier()) {
+        case ocr::MODEL_TIER_DEFAULT:
+        case ocr::MODEL_TIER_STANDARD: out.tier = ModelTier::Standard; break;
+        case ocr::MODEL_TIER_FAST:     out.tier = ModelTier::Fast; break;
+        case ocr::MODEL_TIER_BEST:     out.tier = ModelTier::Best; break;
+        default:
+            error = "unsupported model_tier";
+            return false;
+    }
+
+    if (options.char_whitelist().size() > 256) {
+        error = "char_whitelist too long";
+        return false;
+    }
+    out.whitelist = options.char_whitelist();
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "OcrEngine.h"
+#include "ocr.pb.h"
+
+#include <string>
+#include <vector>
+
+// Named performance profiles. Each is a preset EngineConfig; any option a
+// request sets explicitly overrides the preset.
+//   default  full layout analysis (PSM_AUTO), what the server always did
+//   block    one uniform block of text, skips column/region detection
+//   line     one text line, e.g. the 332x100 strips in dataset/
+//   word     one word, what v1 used
+//   sparse   scattered text in no particular order
+bool profileConfig(const std::string& name, EngineConfig& out);
+
+std::vector<std::string> profileNames();
+
+// tier reported back in OcrResponse
+ocr::ModelTier toProtoModelTier(ModelTier tier);
+
+// mode reported back in OcrResponse
+ocr::PageSegMode toProtoPageSegMode(tesseract::PageSegMode psm);
+
+// turns request options into the engine config that will serve them;
+// false (with error set) for unknown profiles or malformed values
+bool resolveEngineConfig(const ocr::OcrOptions& options,
+                         EngineConfig& out,
+                         std::string& error);
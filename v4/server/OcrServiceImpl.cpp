@@ -1,261 +1,957 @@
 #include "OcrServiceImpl.h"
-#include <condition_variable>
-#include <mutex>
-#include <queue>
+#include "LayoutClassifier.h"
+#include "OcrProfiles.h"
+#include "PixArena.h"
+#include "Sha256.h"
+
 #include <thread>
-#include <atomic>
 #include <iostream>
 #include <chrono>
-#include <filesystem>
-
-#include <tesseract/baseapi.h>
-#include <leptonica/allheaders.h>
-
-// artificial delay per OCR job (for demo visibility)
-static constexpr int kArtificialDelayMs = 1000;
-
-// holds all data needed for processing one image
-struct OcrJob {
-    int batchId;
-    int index;
-    std::string filename;
-    std::string imageData;
-
-    std::string* outText;
-    bool* outSuccess;
-    long long* outMs;
-    std::string* outError;
-    bool* finishedFlag;
-};
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <sstream>
 
+// streamed PSM_AUTO images this large are recognized block by block
+static constexpr long long kStreamBlocksMinPixels = 1000000;
 
-class JobQueue {
-public:
-    void push(const OcrJob& job) {
-        {
-            std::lock_guard<std::mutex> lock(mtx_);
-            queue_.push(job);
+// micro-batched strips are stacked into a page read as one block of text
+static constexpr tesseract::PageSegMode kCompositePageSegMode = tesseract::PSM_SINGLE_BLOCK;
+static constexpr int kMicroBatchMaxWidth = 2000;
+
+static long long usBetween(std::chrono::steady_clock::time_point from,
+                           std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+static long long elapsedUs(std::chrono::steady_clock::time_point since) {
+    return usBetween(since, std::chrono::steady_clock::now());
+}
+
+
+OcrServiceImpl::OcrServiceImpl(const ServerOptions& options)
+    : options_(options),
+      resultCache_(options.resultCacheMb << 20),
+      nearDups_(options.nearDupDistance, options.nearDupEntries),
+      trace_(options.traceEvents)
+{
+    // engines for other languages are loaded on first use
+    engines_ = std::make_unique<EnginePool>(
+        options_.tessdataDir.empty() ? resolveTessdataDir() : options_.tessdataDir,
+        options_.engineMemoryBudgetMb << 20
+    );
+
+    // warm engines for the common profiles so early requests skip Init()
+    for (const std::string& name : options_.prewarmProfiles) {
+        EngineConfig cfg;
+        if (!profileConfig(name, cfg)) {
+            std::cerr << "[Server] Unknown profile to prewarm: " << name << std::endl;
+            continue;
         }
-        cv_.notify_one();
+        engines_->prewarm(cfg, options_.workers);
+    }
+
+    if (!options_.tessdataFastDir.empty()) {
+        engines_->setTierDir(ModelTier::Fast, options_.tessdataFastDir);
+    }
+    if (!options_.tessdataBestDir.empty()) {
+        engines_->setTierDir(ModelTier::Best, options_.tessdataBestDir);
     }
 
-    OcrJob pop() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        cv_.wait(lock, [&]{ return !queue_.empty() || !running_; });
+    FaultInjector::Config faults;
+    std::string faultError;
+    if (FaultInjector::parse(options_.faults, faults, faultError) && faults.any()) {
+        faults_.set(faults);
+        std::cout << "[Server] Fault injection: " << FaultInjector::format(faults) << std::endl;
+    }
 
-        if (!running_ && queue_.empty()) {
-            return {}; // return empty job
-        }
+    // the cascade needs fast models; it escalates to best, else standard
+    cascadeEnabled_ = options_.cascade && engines_->hasTierDir(ModelTier::Fast);
+    accurateTier_ = engines_->hasTierDir(ModelTier::Best) ? ModelTier::Best : ModelTier::Standard;
 
-        OcrJob job = queue_.front();
-        queue_.pop();
-        return job;
+    if (options_.cascade && !cascadeEnabled_) {
+        std::cerr << "[Server] --cascade needs --tessdata-fast; cascade disabled." << std::endl;
+    }
+    if (cascadeEnabled_) {
+        EngineConfig fast;
+        fast.tier = ModelTier::Fast;
+        engines_->prewarm(fast, options_.workers);
+        std::cout << "[Server] Model cascade enabled: fast -> "
+                  << modelTierName(accurateTier_) << " below confidence "
+                  << options_.cascadeThreshold << "." << std::endl;
     }
 
-    void stop() {
-        running_ = false;
-        cv_.notify_all();
+    // the classifier's fast paths must not pay for Init() either
+    if (options_.autoLayout) {
+        for (LayoutClass c : {LayoutClass::SingleWord, LayoutClass::SingleLine}) {
+            EngineConfig cfg;
+            cfg.psm = layoutPageSegMode(c);
+            engines_->prewarm(cfg, options_.workers);
+        }
+        std::cout << "[Server] Layout classifier enabled." << std::endl;
     }
 
-private:
-    std::queue<OcrJob> queue_;
-    std::mutex mtx_;
-    std::condition_variable cv_;
-    std::atomic<bool> running_{true};
+    // workers borrow an engine matching each job's settings
+    // --pix-cache-mb is shared out, not given to every worker
+    const size_t pixCachePerWorker =
+        (options_.pixCacheMb << 20) / static_cast<size_t>(std::max(1, options_.workers));
+    pool_ = std::make_unique<WorkerPool>(options_.workers, [this, pixCachePerWorker](int) {
+        if (PixArena::installed()) PixArena::enableThreadCache(pixCachePerWorker);
+        return [this](OcrJob& job) { return processJob(job); };
+    }, options_.shortestFirst);
+
+    if (options_.microBatchMs > 0) {
+        batcher_ = std::make_unique<MicroBatcher>(
+            options_.microBatchMs, options_.microBatchMax,
+            [this](std::vector<OcrJob> jobs) {
+                if (jobs.size() == 1) {
+                    pool_->pushJob(std::move(jobs.front()));
+                    return;
+                }
+                OcrJob task;
+                for (const OcrJob& j : jobs) task.expectedCostUs += j.expectedCostUs;
+                auto batch = std::make_shared<std::vector<OcrJob>>(std::move(jobs));
+                task.task = [this, batch]() { processBatch(*batch); };
+                pool_->pushJob(std::move(task));
+            });
+        std::cout << "[Server] Micro-batching images up to "
+                  << options_.microBatchMaxHeight << " px tall, "
+                  << options_.microBatchMs << " ms window." << std::endl;
+    }
+}
+
+// a large page split into text blocks; shared by the worker that owns the
+// page and the idle workers it recruited, whichever finishes last frees it
+struct OcrServiceImpl::SplitPage {
+    PIX* pix = nullptr;
+    EngineConfig cfg;
+    bool autoTier = false;
+
+    // streaming: blocks are passed on in reading order as the prefix completes
+    std::function<void(const TextSegment&)> onSegment;
+    tesseract::PageIteratorLevel segmentLevel = tesseract::RIL_TEXTLINE;
+
+    std::vector<PixRegion> regions;
+    std::vector<OcrResult> results;
+    std::atomic<int> next{0};
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    int remaining = 0;
+    std::vector<char> finished;
+    size_t emitted = 0;
+
+    ~SplitPage() { pixDestroy(&pix); }
 };
 
+bool OcrServiceImpl::recognizeWith(const EngineConfig& cfg, PIX* pix,
+                                   const PixRegion* region,
+                                   const tesseract::PageIteratorLevel* segmentLevel,
+                                   OcrResult& result) {
+    EnginePool::Lease engine = engines_->acquire(cfg);
+    if (!engine) {
+        result.error = "OCR engine unavailable for " + cfg.language
+                     + " (" + modelTierName(cfg.tier) + " models)";
+        return false;
+    }
+
+    bool ok = false;
+    if (segmentLevel) {
+        result.segments.clear();
+        ok = engine->recognizeSegments(pix, region, *segmentLevel, result.segments, result.text);
+    } else {
+        long long ms = 0;
+        ok = engine->recognize(pix, result.text, ms, region);
+    }
+    result.tier = cfg.tier;
+    result.confidence = engine->lastConfidence();
+    return ok;
+}
+
+void OcrServiceImpl::stallEngine(EngineConfig cfg, bool autoTier, long long stallUs) {
+    if (cascadeEnabled_ && autoTier) cfg.tier = ModelTier::Fast;
+    EnginePool::Lease engine = engines_->acquire(cfg);
+    std::this_thread::sleep_for(std::chrono::microseconds(stallUs));
+}
+
+bool OcrServiceImpl::recognizeTiered(EngineConfig cfg, bool autoTier, PIX* pix,
+                                     const PixRegion* region,
+                                     const tesseract::PageIteratorLevel* segmentLevel,
+                                     OcrResult& result) {
+    if (!cascadeEnabled_ || !autoTier) {
+        return recognizeWith(cfg, pix, region, segmentLevel, result);
+    }
+
+    // cheap tier first; only low-confidence images pay for the accurate one
+    auto fastStart = std::chrono::steady_clock::now();
+    cfg.tier = ModelTier::Fast;
+    bool ok = recognizeWith(cfg, pix, region, segmentLevel, result);
+    metrics_.cascadeFast.record(elapsedUs(fastStart));
 
-class OcrEngine {
-public:
-    OcrEngine() {
-        const char* env = std::getenv("TESSDATA_PREFIX");
-        const char* tessdata = nullptr;
+    if (ok && result.confidence >= options_.cascadeThreshold) {
+        metrics_.cascadeFastAccepted++;
+        return true;
+    }
 
-        if (env && std::strlen(env) > 0) {
-            tessdata = env;
-        } 
-        else {
-            // Apple Silicon Homebrew
-            if (std::filesystem::exists("/opt/homebrew/share/tessdata/eng.traineddata")) {
-                tessdata = "/opt/homebrew/share/tessdata";
-            }
-            // Intel Homebrew 
-            else if (std::filesystem::exists("/usr/local/share/tessdata/eng.traineddata")) {
-                tessdata = "/usr/local/share/tessdata";
-            }
-            // Apple Homebrew Cellar 
-            else if (std::filesystem::exists("/opt/homebrew/opt/tesseract/share/tessdata/eng.traineddata")) {
-                tessdata = "/opt/homebrew/opt/tesseract/share/tessdata";
-            }
-            // Intel Cellar 
-            else if (std::filesystem::exists("/usr/local/Cellar/tesseract/5.5.1_1/share/tessdata/eng.traineddata")) {
-                tessdata = "/usr/local/Cellar/tesseract/5.5.1_1/share/tessdata";
-            }
-            else {
-                tessdata = ".";  
+    // also covers a fast engine that failed to load
+    result.error.clear();
+    auto accurateStart = std::chrono::steady_clock::now();
+    cfg.tier = accurateTier_;
+    ok = recognizeWith(cfg, pix, region, segmentLevel, result);
+    result.escalated = true;
+    metrics_.cascadeEscalated++;
+    metrics_.cascadeAccurate.record(elapsedUs(accurateStart));
+    return ok;
+}
+
+void OcrServiceImpl::runSplitRegions(SplitPage& page) {
+    const int n = static_cast<int>(page.regions.size());
+
+    // each block gets uniform-block segmentation; layout was done already
+    EngineConfig cfg = page.cfg;
+    cfg.psm = tesseract::PSM_SINGLE_BLOCK;
+    const tesseract::PageIteratorLevel* segmentLevel =
+        page.onSegment ? &page.segmentLevel : nullptr;
+
+    for (int i = page.next++; i < n; i = page.next++) {
+        OcrResult& r = page.results[i];
+        r.success = recognizeTiered(cfg, page.autoTier, page.pix,
+                                    &page.regions[i], segmentLevel, r);
+
+        std::lock_guard<std::mutex> lock(page.mtx);
+        page.finished[i] = 1;
+
+        // stream out whatever is now complete from the top of the page
+        while (page.onSegment && page.emitted < page.finished.size() &&
+               page.finished[page.emitted]) {
+            for (const TextSegment& seg : page.results[page.emitted].segments) {
+                page.onSegment(seg);
             }
+            page.emitted++;
         }
 
-        int rc = tess_.Init(tessdata, "eng");
-        if (rc != 0) {
-            std::cerr << "[OCR] Failed to initialize Tesseract.\n";
-            initialized_ = false;
-            return;
-        }
+        if (--page.remaining == 0) page.cv.notify_all();
+    }
+}
+
+bool OcrServiceImpl::recognizeSplit(const EngineConfig& cfg, const OcrJob& job,
+                                    PIX* pix, bool recruitHelpers,
+                                    OcrResult& result) {
+    auto layoutStart = std::chrono::steady_clock::now();
+
+    std::vector<PixRegion> blocks;
+    {
+        EngineConfig layoutCfg = cfg;
+        layoutCfg.psm = tesseract::PSM_AUTO;
+        EnginePool::Lease engine = engines_->acquire(layoutCfg);
+        if (engine) blocks = engine->layoutBlocks(pix);
+    }
+    metrics_.splitLayout.record(elapsedUs(layoutStart));
+
+    // nothing to fan out; the caller recognizes the page as usual
+    if (blocks.size() < 2) return false;
+
+    auto page = std::make_shared<SplitPage>();
+    page->pix = pixClone(pix);
+    page->cfg = cfg;
+    page->autoTier = job.autoTier;
+    page->onSegment = job.onSegment;
+    page->segmentLevel = job.segmentLevel;
+    page->regions = std::move(blocks);
+    page->results.resize(page->regions.size());
+    page->finished.assign(page->regions.size(), 0);
+    page->remaining = static_cast<int>(page->regions.size());
+
+    // recruit only workers that are idle right now; queued images keep
+    // their place, and we work through the blocks ourselves meanwhile
+    const int helpers = recruitHelpers
+        ? std::min(pool_->idleWorkers(), page->remaining - 1)
+        : 0;
+    for (int i = 0; i < helpers; i++) {
+        OcrJob helper;
+        helper.task = [this, page]() { runSplitRegions(*page); };
+        pool_->pushUrgent(std::move(helper));
+    }
 
-        tess_.SetPageSegMode(tesseract::PSM_AUTO);
-        initialized_ = true;
+    runSplitRegions(*page);
+    {
+        std::unique_lock<std::mutex> lock(page->mtx);
+        page->cv.wait(lock, [&]{ return page->remaining == 0; });
     }
 
-    ~OcrEngine() {
-        if (initialized_) tess_.End();
+    metrics_.splitPages++;
+    metrics_.splitRegions += static_cast<long long>(page->regions.size());
+    metrics_.splitHelpers += helpers;
+
+    // no block came out; the caller tries the page whole, which also
+    // reports why it failed
+    int succeeded = 0;
+    for (const OcrResult& r : page->results) succeeded += r.success ? 1 : 0;
+    if (succeeded == 0) return false;
+
+    // put the text back together in Tesseract's reading order; confidence
+    // is over the blocks that were read, failed ones have none
+    int confidenceSum = 0;
+    result.text.clear();
+    for (OcrResult& r : page->results) {
+        if (!r.success) continue;
+        result.text += r.text;
+        if (!result.text.empty() && result.text.back() != '\n') result.text += '\n';
+        confidenceSum += r.confidence;
+        result.escalated = result.escalated || r.escalated;
+        result.tier = r.tier;
+    }
+    result.confidence = confidenceSum / succeeded;
+    result.success = true;
+    return true;
+}
+
+OcrResult OcrServiceImpl::processJob(OcrJob& job) {
+    OcrResult result;
+    auto start = std::chrono::steady_clock::now();
+
+    StageTimes stages;
+    stages.workerId = WorkerPool::currentWorkerId();
+    stages.dequeuedUs = elapsedUs(job.receivedAt);
+
+    PIX* pix = pixReadMem((l_uint8*)job.imageData.data(), job.imageData.size());
+    stages.decodedUs = elapsedUs(job.receivedAt);
+    if (!pix) {
+        result.error = "OCR failed: invalid image data";
+        result.stages = stages;
+        return result;
     }
 
-    bool recognize(const std::string &img, std::string &out, long long &ms) {
-        if (!initialized_) return false;
+    // a re-scan of something already recognized takes the earlier text
+    PerceptualHash phash;
+    std::string nearDupSettings;
+    if (nearDups_.enabled() && perceptualHash(pix, phash)) {
+        nearDupSettings = ResultCache::settingsKey(job);
+
+        int distance = 0;
+        if (nearDups_.find(phash, nearDupSettings, result, distance)) {
+            pixDestroy(&pix);
+            result.nearDuplicate = true;
+            result.nearDuplicateDistance = distance;
+            result.ms = elapsedUs(start) / 1000;
+            result.stages = stages;
+            return result;
+        }
+    }
 
-        auto start = std::chrono::steady_clock::now();
+    EngineConfig cfg = job.config;
 
-        PIX* pix = pixReadMem((l_uint8*)img.data(), img.size());
-        if (!pix) return false;
+    int layout = -1;
+    if (options_.autoLayout && job.autoLayout) {
+        auto classifyStart = std::chrono::steady_clock::now();
+        LayoutClass c = classifyLayout(pix);
+        metrics_.layoutClassify.record(elapsedUs(classifyStart));
 
-        tess_.SetImage(pix);
-        char* raw = tess_.GetUTF8Text();
-        pixDestroy(&pix);
+        cfg.psm = layoutPageSegMode(c);
+        layout = static_cast<int>(c);
+    } else if (options_.autoLayout) {
+        metrics_.layoutBypassed++;
+    }
 
-        auto end = std::chrono::steady_clock::now();
-        ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    auto recognizeStart = std::chrono::steady_clock::now();
+    bool ok = false;
+
+    // injected stall (off unless --faults / SetFaults)
+    const long long stallUs = faults_.stallUs();
+    if (stallUs > 0) stallEngine(cfg, job.autoTier, stallUs);
+
+    // big multi-block pages are spread over idle workers; streamed pages are
+    // recognized block by block even without helpers, so the first block
+    // reaches the client long before the whole page is done
+    const long long pixels = static_cast<long long>(pixGetWidth(pix)) * pixGetHeight(pix);
+    const bool layoutPage = cfg.psm == tesseract::PSM_AUTO;
+    const bool splittable = layoutPage && options_.splitMinPixels > 0 &&
+                            pixels >= options_.splitMinPixels;
+    const bool streamBlocks = layoutPage && job.onSegment &&
+                              pixels >= kStreamBlocksMinPixels;
+
+    if ((splittable || streamBlocks) &&
+        recognizeSplit(cfg, job, pix, splittable, result)) {
+        ok = result.success;
+    } else {
+        const tesseract::PageIteratorLevel* segmentLevel =
+            job.onSegment ? &job.segmentLevel : nullptr;
+        ok = recognizeTiered(cfg, job.autoTier, pix, nullptr, segmentLevel, result);
 
-        if (raw) {
-            out = raw;
-            delete[] raw;
-            return true;
+        if (ok && job.onSegment) {
+            for (const TextSegment& seg : result.segments) job.onSegment(seg);
         }
-        return false;
     }
+    result.segments.clear();
 
-private:
-    tesseract::TessBaseAPI tess_;
-    bool initialized_ = false;
-};
+    if (layout >= 0) {
+        metrics_.layoutRecognize[layout].record(elapsedUs(recognizeStart));
+    }
+    pixDestroy(&pix);
+    stages.recognizedUs = elapsedUs(job.receivedAt);
+    result.stages = stages;
 
+    if (!result.error.empty()) return result;
 
-class WorkerPool {
-public:
-    WorkerPool(int n) : running_(true) {
-        for (int i = 0; i < n; i++) {
-            workers_.emplace_back(&WorkerPool::workerLoop, this);
-        }
+    result.ms = elapsedUs(start) / 1000;
+    result.psm = cfg.psm;
+
+    // injected latency (off unless --faults / SetFaults)
+    const long long delayUs = faults_.workerDelayUs(stages.workerId, elapsedUs(start));
+    if (delayUs > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+    }
+    result.stages.delayDoneUs = elapsedUs(job.receivedAt);
+
+    result.success = ok;
+    if (!ok) {
+        result.text.clear();
+        result.error = "OCR failed";
     }
 
-    ~WorkerPool() {
-        running_ = false;
-        queue_.stop();
+    // how long the worker was tied up, which is what the queue waits on
+    costModel_.observe(ResultCache::settingsKey(job), job.costFeatures, elapsedUs(start));
+
+    if (!nearDupSettings.empty()) nearDups_.add(phash, nearDupSettings, result);
+    return result;
+}
 
-        for (auto &t : workers_) {
-            if (t.joinable()) t.join();
+void OcrServiceImpl::estimateCost(OcrJob& job) {
+    job.costFeatures = CostModel::features(job.imageData);
+    job.expectedCostUs = costModel_.predictUs(ResultCache::settingsKey(job), job.costFeatures);
+}
+
+bool OcrServiceImpl::batchable(const OcrJob& job) const {
+    if (!batcher_ || job.imageData.empty() || job.onSegment) return false;
+
+    // the composite is read as one block, so only jobs that asked for a
+    // block (or for layout analysis, which finds one on a small image) get
+    // the same reading there; line and word modes would not
+    if (job.config.psm != tesseract::PSM_AUTO &&
+        job.config.psm != tesseract::PSM_SINGLE_BLOCK) {
+        return false;
+    }
+    return isSmallImage(job.imageData, kMicroBatchMaxWidth, options_.microBatchMaxHeight);
+}
+
+void OcrServiceImpl::processBatch(std::vector<OcrJob>& jobs) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<OcrResult> results(jobs.size());
+    std::vector<PIX*> strips;
+    std::vector<size_t> owners;     // job index of each strip
+    std::vector<long long> areas;   // pixels of each strip
+    long long totalArea = 0;
+
+    for (size_t i = 0; i < jobs.size(); i++) {
+        StageTimes& stages = results[i].stages;
+        stages.workerId = WorkerPool::currentWorkerId();
+        stages.dequeuedUs = usBetween(jobs[i].receivedAt, start);
+
+        PIX* pix = pixReadMem((l_uint8*)jobs[i].imageData.data(), jobs[i].imageData.size());
+        stages.decodedUs = elapsedUs(jobs[i].receivedAt);
+        if (!pix) {
+            results[i].error = "OCR failed: invalid image data";
+            continue;
         }
+        strips.push_back(pix);
+        owners.push_back(i);
+        areas.push_back(static_cast<long long>(pixGetWidth(pix)) * pixGetHeight(pix));
+        totalArea += areas.back();
     }
 
-    void pushJob(const OcrJob& job) {
-        queue_.push(job);
+    // all jobs share their settings; the first stands in for the batch
+    try {
+        CompositePage page;
+        if (!strips.empty() && page.build(strips)) {
+            const OcrJob& first = jobs[owners.front()];
+            EngineConfig cfg = first.config;
+            cfg.psm = kCompositePageSegMode;
+            const tesseract::PageIteratorLevel level = tesseract::RIL_TEXTLINE;
+
+            // one stall for the page, like the delay below
+            const long long stallUs = faults_.stallUs();
+            if (stallUs > 0) stallEngine(cfg, first.autoTier, stallUs);
+
+            OcrResult pageResult;
+            bool ok = recognizeTiered(cfg, first.autoTier, page.pix(), nullptr, &level, pageResult);
+
+            std::vector<std::string> texts;
+            std::vector<int> confidences;
+            if (ok) page.split(pageResult.segments, texts, confidences);
+
+            for (size_t k = 0; k < owners.size(); k++) {
+                OcrResult& r = results[owners[k]];
+                r.success = ok;
+                r.error = ok ? std::string() : "OCR failed";
+                if (!ok) continue;
+                r.text = std::move(texts[k]);
+                r.confidence = confidences[k];
+                r.tier = pageResult.tier;
+                r.escalated = pageResult.escalated;
+                r.psm = cfg.psm;
+            }
+        } else {
+            for (size_t i : owners) results[i].error = "OCR failed";
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "[Server] Micro-batch failed: " << ex.what() << std::endl;
+        for (size_t i : owners) {
+            results[i].success = false;
+            results[i].error = "OCR failed";
+        }
+    }
+    for (PIX*& pix : strips) pixDestroy(&pix);
+    auto recognized = std::chrono::steady_clock::now();
+
+    // one injected delay for the page, as for any other job
+    const long long delayUs = faults_.workerDelayUs(WorkerPool::currentWorkerId(),
+                                                    usBetween(start, recognized));
+    if (delayUs > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+    }
+    auto delayDone = std::chrono::steady_clock::now();
+
+    // each job's share of the page by area, so the cost model learns what
+    // a batched image costs rather than what the whole batch did
+    const long long batchUs = usBetween(start, delayDone);
+    for (size_t k = 0; k < owners.size() && totalArea > 0; k++) {
+        const OcrJob& job = jobs[owners[k]];
+        costModel_.observe(ResultCache::settingsKey(job), job.costFeatures,
+                           batchUs * areas[k] / totalArea);
     }
 
-private:
-    void workerLoop() {
-        OcrEngine engine;
+    const long long ms = usBetween(start, recognized) / 1000;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        results[i].ms = ms;
+        results[i].stages.recognizedUs = usBetween(jobs[i].receivedAt, recognized);
+        results[i].stages.delayDoneUs = usBetween(jobs[i].receivedAt, delayDone);
+        jobs[i].done->set_value(std::move(results[i]));
+    }
 
-        while (running_) {
-            OcrJob job = queue_.pop();
+    metrics_.microBatches++;
+    metrics_.microBatchedImages += static_cast<long long>(jobs.size());
+}
 
-            if (!running_) break;
+grpc::Status OcrServiceImpl::attachSharedImage(
+    grpc::ServerContext* ctx,
+    const ocr::ShmSlot& slot,
+    OcrJob& job)
+{
+    // a bad segment can fault this process, so only peers that could reach
+    // the socket file (same host, same permissions) get to name one
+    if (options_.unixSocket.empty() || ctx->peer().rfind("unix:", 0) != 0) {
+        return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                            "shared memory images are only accepted over the Unix socket");
+    }
 
-            std::string text, error;
-            long long ms = 0;
-            bool ok = engine.recognize(job.imageData, text, ms);
+    ShmSlotHandle handle;
+    handle.segment = slot.segment();
+    handle.slot = slot.slot();
+    handle.generation = slot.generation();
+    handle.length = slot.length();
+
+    std::string error;
+    std::string_view bytes;
+    std::shared_ptr<const ShmMapping> mapping = shmSegments_.get(handle.segment, error);
+    if (mapping && !mapping->view(handle, bytes, error)) {
+        // the client may have restarted under a name we still have mapped
+        shmSegments_.forget(handle.segment);
+        mapping = shmSegments_.get(handle.segment, error);
+        if (mapping && !mapping->view(handle, bytes, error)) mapping.reset();
+    }
+    if (!mapping) {
+        std::cout << "[Server] Rejected shared memory image: " << error << std::endl;
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error);
+    }
 
-            // Artificial delay to slow down completion for demo visibility
-            if (kArtificialDelayMs > 0) {
-                std::this_thread::sleep_for(
-                    std::chrono::milliseconds(kArtificialDelayMs)
-                );
-            }
+    job.imageData = bytes;
+    job.imageOwner = std::move(mapping);
+    metrics_.sharedMemoryRequests++;
+    return grpc::Status::OK;
+}
 
-            *(job.outText) = ok ? text : "";
-            *(job.outSuccess) = ok;
-            *(job.outMs) = ms;
-            *(job.outError) = ok ? "" : "OCR failed";
-            *(job.finishedFlag) = true;
+grpc::Status OcrServiceImpl::buildJob(
+    grpc::ServerContext* ctx,
+    const ocr::OcrRequest& req,
+    OcrJob& job)
+{
+    job.batchId = req.batch_id();
+    job.index = req.image_index();
+    job.filename = req.filename();
+
+    if (req.has_shm_slot()) {
+        grpc::Status status = attachSharedImage(ctx, req.shm_slot(), job);
+        if (!status.ok()) return status;
+    } else {
+        job.imageData = req.image_data();
+    }
+
+    std::string invalid;
+    if (!resolveEngineConfig(req.options(), job.config, invalid)) {
+        std::cout << "[Server] Rejected request: " << invalid << std::endl;
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, invalid);
+    }
+    job.autoLayout = req.options().page_seg_mode() == ocr::PAGE_SEG_DEFAULT &&
+                     req.options().profile().empty();
+    job.autoTier = req.options().model_tier() == ocr::MODEL_TIER_DEFAULT;
+
+    // an asked-for tier we have no models for would quietly run on the
+    // standard ones while the response still named the tier asked for
+    if (!job.autoTier && !engines_->hasTierDir(job.config.tier)) {
+        std::string error = std::string("no ") + modelTierName(job.config.tier) +
+                            " models on this server";
+        std::cout << "[Server] Rejected request: " << error << std::endl;
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error);
+    }
+
+    // shared-memory bytes stay writable by the client until a worker has
+    // decoded them, so hashing them here wouldn't prove what gets read;
+    // those requests neither use nor fill the cache, nor join others
+    if ((resultCache_.enabled() || options_.coalesce) && !req.has_shm_slot()) {
+        if (!job.imageData.empty()) {
+            // hash what we were sent; a client's claimed hash could
+            // otherwise plant a wrong result for everyone else
+            job.cacheKey = ResultCache::key(Sha256::toBytes(Sha256::hash(job.imageData)), job);
+        } else if (req.content_sha256().size() == 32) {
+            job.cacheKey = ResultCache::key(req.content_sha256(), job);
         }
     }
+    if (job.imageData.empty() && !req.content_sha256().empty() &&
+        req.content_sha256().size() != 32) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                            "content_sha256 must be 32 bytes");
+    }
 
-    std::vector<std::thread> workers_;
-    std::atomic<bool> running_;
-    JobQueue queue_;
-};
+    job.done = std::make_shared<std::promise<OcrResult>>();
+    return grpc::Status::OK;
+}
+
+void OcrServiceImpl::fillResponse(const ocr::OcrRequest& req,
+                                  const OcrResult& result,
+                                  ocr::OcrResponse* res) {
+    if (result.success) {
+        std::cout << "[Server] OCR SUCCESS for [" << req.filename() << "]" 
+                  << " | Time: " << result.ms << " ms"
+                  << " | Tier: " << modelTierName(result.tier)
+                  << " | Conf: " << result.confidence;
+        if (result.nearDuplicate) {
+            std::cout << " | Near-duplicate (" << result.nearDuplicateDistance << " bits)";
+        }
+        std::cout << std::endl;
+    } else {
+        std::cout << "[Server] OCR FAILED for [" << req.filename() << "]"
+                  << " | Error: " << result.error << std::endl;
+    }
 
+    res->set_batch_id(req.batch_id());
+    res->set_image_index(req.image_index());
+    res->set_filename(req.filename());
+    res->set_text(result.text);
+    res->set_success(result.success);
+    res->set_error_message(result.error);
+    res->set_processing_time_ms(result.ms);
+    res->set_page_seg_mode(toProtoPageSegMode(result.psm));
+    res->set_model_tier(toProtoModelTier(result.tier));
+    res->set_confidence(result.confidence);
+    res->set_escalated(result.escalated);
+    res->set_near_duplicate(result.nearDuplicate);
+    res->set_near_duplicate_distance(result.nearDuplicateDistance);
+}
+
+void OcrServiceImpl::fillTimings(const ocr::OcrRequest& req,
+                                 std::chrono::steady_clock::time_point receivedAt,
+                                 const StageTimes& stages,
+                                 long long queuedUs, long long completedUs,
+                                 ocr::OcrResponse* res) {
+    const long long respondedUs = elapsedUs(receivedAt);
+    ocr::StageTimings* t = res->mutable_timings();
+    t->set_queued_us(queuedUs);
+    t->set_dequeued_us(stages.dequeuedUs);
+    t->set_decoded_us(stages.decodedUs);
+    t->set_recognized_us(stages.recognizedUs);
+    t->set_delay_done_us(stages.delayDoneUs);
+    t->set_completed_us(completedUs);
+    t->set_worker_id(stages.workerId);
+    t->set_responded_us(respondedUs);
+
+    trace_.recordRequest(req.filename(), receivedAt, stages, queuedUs, completedUs, respondedUs);
+}
+
+bool OcrServiceImpl::answerFromCache(const ocr::OcrRequest& req,
+                                     const OcrJob& job,
+                                     ocr::OcrResponse* res) {
+    OcrResult cached;
+    if (!job.cacheKey.empty() && resultCache_.get(job.cacheKey, cached)) {
+        std::cout << "[Server] Result cache hit for [" << req.filename() << "]"
+                  << (job.imageData.empty() ? " (hash only)" : "") << std::endl;
+        fillResponse(req, cached, res);
+        res->set_cache_hit(true);
+        return true;
+    }
 
-OcrServiceImpl::OcrServiceImpl(int workerCount)
-    : workerCount_(workerCount)
-{}
+    if (job.imageData.empty() && !req.content_sha256().empty()) {
+        res->set_batch_id(req.batch_id());
+        res->set_image_index(req.image_index());
+        res->set_filename(req.filename());
+        res->set_success(false);
+        res->set_needs_image(true);
+        return true;
+    }
+    return false;
+}
 
 grpc::Status OcrServiceImpl::RecognizeImage(
-    grpc::ServerContext*,
+    grpc::ServerContext* ctx,
     const ocr::OcrRequest* req,
     ocr::OcrResponse* res)
 {
-    static WorkerPool pool(workerCount_);
+    const auto received = std::chrono::steady_clock::now();
 
     std::cout << "[Server] Received image request from client:" << std::endl;
     std::cout << "         Filename: " << req->filename() 
               << " | Index: " << req->image_index()
               << " | Batch: " << req->batch_id() << std::endl;
 
-    std::string text, error;
-    long long ms = 0;
-    bool success = false;
-    bool finished = false;
+    if (faults_.shouldFail()) {
+        return grpc::Status(grpc::StatusCode::UNAVAILABLE, "injected failure");
+    }
 
     // build OCR Job
     OcrJob job;
-    job.batchId = req->batch_id();
-    job.index = req->image_index();
-    job.filename = req->filename();
-    job.imageData = req->image_data();
-
-    job.outText = &text;
-    job.outSuccess = &success;
-    job.outMs = &ms;
-    job.outError = &error;
-    job.finishedFlag = &finished;
+    job.receivedAt = received;
+    grpc::Status status = buildJob(ctx, *req, job);
+    if (!status.ok()) return status;
 
-    // push job into worker pool
-    pool.pushJob(job);
-    std::cout << "[Server] Job pushed to worker pool..." << std::endl;
+    if (answerFromCache(*req, job, res)) {
+        fillTimings(*req, received, StageTimes(), 0, 0, res);
+        return grpc::Status::OK;
+    }
 
-    // busy wait until job is done
-    while (!finished) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::string cacheKey = job.cacheKey;
+    std::shared_future<OcrResult> pending = job.done->get_future().share();
+
+    // the same image with the same settings already queued or running:
+    // wait for that job instead of running Tesseract on it again
+    const bool coalesce = options_.coalesce && !cacheKey.empty();
+    if (coalesce && inFlight_.joinOrLead(cacheKey, pending)) {
+        metrics_.coalescedRequests++;
+        std::cout << "[Server] Joined identical in-flight job for ["
+                  << req->filename() << "]" << std::endl;
+
+        // the leader's stage times are relative to its own arrival
+        fillResponse(*req, pending.get(), res);
+        fillTimings(*req, received, StageTimes(), 0, elapsedUs(received), res);
+        return grpc::Status::OK;
     }
 
-    if (success) {
-        std::cout << "[Server] OCR SUCCESS for [" << job.filename << "]" 
-                  << " | Time: " << ms << " ms" << std::endl;
+    // push job into worker pool, or hold it for a composite page
+    estimateCost(job);
+    const long long queuedUs = elapsedUs(received);
+    long long expectedUs = 0;
+    if (batchable(job)) {
+        // the batch window, then the queue as it stands, then this job's
+        // share of the page (its own cost, as processBatch observes it)
+        expectedUs = options_.microBatchMs * 1000LL + pool_->backlogUs() + job.expectedCostUs;
+        std::string settings = ResultCache::settingsKey(job);
+        batcher_->add(std::move(job), settings);
+        std::cout << "[Server] Job held for micro-batch, expected in "
+                  << expectedUs / 1000 << " ms..." << std::endl;
     } else {
-        std::cout << "[Server] OCR FAILED for [" << job.filename << "]"
-                  << " | Error: " << error << std::endl;
+        expectedUs = pool_->pushJob(std::move(job));
+        std::cout << "[Server] Job pushed to worker pool, expected in "
+                  << expectedUs / 1000 << " ms..." << std::endl;
     }
 
+    // wait until a worker has finished the job
+    OcrResult result = pending.get();
+    const long long completedUs = elapsedUs(received);
+
+    // cache before leaving the in-flight table, so a request arriving in
+    // between finds the result one way or the other
+    if (!cacheKey.empty()) resultCache_.put(cacheKey, result);
+    if (coalesce) inFlight_.finish(cacheKey);
+
     // fill gRPC response
-    res->set_batch_id(job.batchId);
-    res->set_image_index(job.index);
-    res->set_filename(job.filename);
-    res->set_text(text);
-    res->set_success(success);
-    res->set_error_message(error);
-    res->set_processing_time_ms(ms);
+    fillResponse(*req, result, res);
+    res->set_expected_ms(expectedUs / 1000);
+    fillTimings(*req, received, result.stages, queuedUs, completedUs, res);
 
     std::cout << "[Server] Sending OCR response back to client..." << std::endl;
 
     return grpc::Status::OK;
-}
\ No newline at end of file
+}
+
+grpc::Status OcrServiceImpl::RecognizeImageStream(
+    grpc::ServerContext* ctx,
+    const ocr::OcrRequest* req,
+    grpc::ServerWriter<ocr::OcrStreamMessage>* writer)
+{
+    const auto received = std::chrono::steady_clock::now();
+
+    std::cout << "[Server] Received streaming request from client:" << std::endl;
+    std::cout << "         Filename: " << req->filename() 
+              << " | Index: " << req->image_index()
+              << " | Batch: " << req->batch_id() << std::endl;
+
+    if (faults_.shouldFail()) {
+        return grpc::Status(grpc::StatusCode::UNAVAILABLE, "injected failure");
+    }
+
+    OcrJob job;
+    job.receivedAt = received;
+    grpc::Status status = buildJob(ctx, *req, job);
+    if (!status.ok()) return status;
+
+    // a cached result has no segments; it goes out as the summary alone
+    ocr::OcrStreamMessage cachedSummary;
+    if (answerFromCache(*req, job, cachedSummary.mutable_summary())) {
+        fillTimings(*req, received, StageTimes(), 0, 0, cachedSummary.mutable_summary());
+        writer->Write(cachedSummary);
+        return grpc::Status::OK;
+    }
+    std::string cacheKey = job.cacheKey;
+
+    // segments arrive on worker threads; only this thread writes the stream.
+    // shared so a worker can still push after a cancelled call returned
+    struct Outbox {
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<TextSegment> segments;
+    };
+    auto outbox = std::make_shared<Outbox>();
+
+    job.segmentLevel = req->options().stream_level() == ocr::STREAM_LEVEL_BLOCK
+                     ? tesseract::RIL_BLOCK
+                     : tesseract::RIL_TEXTLINE;
+    job.onSegment = [outbox](const TextSegment& seg) {
+        std::lock_guard<std::mutex> lock(outbox->mtx);
+        outbox->segments.push_back(seg);
+        outbox->cv.notify_one();
+    };
+
+    estimateCost(job);
+    std::future<OcrResult> pending = job.done->get_future();
+    const long long queuedUs = elapsedUs(received);
+    const long long expectedUs = pool_->pushJob(std::move(job));
+
+    ocr::OcrStreamMessage queued;
+    queued.mutable_queued()->set_expected_ms(expectedUs / 1000);
+    writer->Write(queued);
+
+    int sequence = 0;
+    for (;;) {
+        // all segments are pushed before the job's promise is fulfilled, so
+        // once it is ready, draining the outbox one last time sends them all
+        bool finished = pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+
+        std::deque<TextSegment> batch;
+        {
+            std::unique_lock<std::mutex> lock(outbox->mtx);
+            if (!finished) {
+                outbox->cv.wait_for(lock, std::chrono::milliseconds(5),
+                                    [&]{ return !outbox->segments.empty(); });
+            }
+            batch.swap(outbox->segments);
+        }
+
+        for (const TextSegment& seg : batch) {
+            ocr::OcrStreamMessage msg;
+            ocr::OcrPartial* partial = msg.mutable_partial();
+            partial->set_sequence(sequence++);
+            partial->set_text(seg.text);
+            partial->set_confidence(seg.confidence);
+            partial->mutable_box()->set_x(seg.box.x);
+            partial->mutable_box()->set_y(seg.box.y);
+            partial->mutable_box()->set_width(seg.box.w);
+            partial->mutable_box()->set_height(seg.box.h);
+
+            if (ctx->IsCancelled() || !writer->Write(msg)) {
+                // the job still reads the request's bytes
+                pending.wait();
+                return grpc::Status(grpc::StatusCode::CANCELLED, "client went away");
+            }
+        }
+
+        if (finished) break;
+    }
+
+    OcrResult result = pending.get();
+    const long long completedUs = elapsedUs(received);
+    if (!cacheKey.empty()) resultCache_.put(cacheKey, result);
+
+    ocr::OcrStreamMessage summary;
+    fillResponse(*req, result, summary.mutable_summary());
+    summary.mutable_summary()->set_expected_ms(expectedUs / 1000);
+    fillTimings(*req, received, result.stages, queuedUs, completedUs, summary.mutable_summary());
+    writer->Write(summary);
+
+    std::cout << "[Server] Streamed " << sequence << " partial results for ["
+              << req->filename() << "]" << std::endl;
+
+    return grpc::Status::OK;
+}
+
+grpc::Status OcrServiceImpl::GetServerStats(
+    grpc::ServerContext*,
+    const ocr::StatsRequest*,
+    ocr::ServerStats* res)
+{
+    metrics_.fill(res);
+    engines_->fill(res);
+    resultCache_.fill(res);
+    nearDups_.fill(res);
+    PixArena::fill(res);
+    costModel_.fill(res);
+    faults_.fill(res);
+    res->set_queue_expected_ms(pool_->backlogUs() / 1000);
+    return grpc::Status::OK;
+}
+
+grpc::Status OcrServiceImpl::DumpTrace(
+    grpc::ServerContext*,
+    const ocr::TraceRequest*,
+    ocr::TraceDump* res)
+{
+    res->set_enabled(trace_.enabled());
+    if (!trace_.enabled()) return grpc::Status::OK;
+
+    std::ostringstream json;
+    trace_.writeChromeTrace(json);
+    res->set_chrome_trace_json(json.str());
+    res->set_spans_recorded(trace_.recorded());
+    res->set_spans_dropped(trace_.dropped());
+    return grpc::Status::OK;
+}
+
+grpc::Status OcrServiceImpl::SetFaults(
+    grpc::ServerContext*,
+    const ocr::FaultSpec* req,
+    ocr::FaultSpec* res)
+{
+    if (!options_.faultRpc) {
+        return grpc::Status(grpc::StatusCode::PERMISSION_DENIED,
+                            "fault injection RPC is off (--allow-fault-rpc)");
+    }
+
+    FaultInjector::Config cfg;
+    std::string error;
+    if (!FaultInjector::parse(req->spec(), cfg, error)) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, error);
+    }
+    faults_.set(cfg);
+    res->set_spec(FaultInjector::format(cfg));
+
+    std::cout << "[Server] Fault injection: " << res->spec() << std::endl;
+    return grpc::Status::OK;
+}
+
+bool OcrServiceImpl::writeTrace(const std::string& path) const {
+    if (!trace_.enabled()) return false;
+
+    std::ofstream out(path, std::ios::binary);
+    trace_.writeChromeTrace(out);
+    return static_cast<bool>(out.flush());
+}
@@ -2,10 +2,23 @@
 
 #include <grpcpp/grpcpp.h>
 #include "ocr.grpc.pb.h"
+#include "EnginePool.h"
+#include "FaultInjector.h"
+#include "InFlightJobs.h"
+#include "MicroBatch.h"
+#include "NearDupIndex.h"
+#include "ResultCache.h"
+#include "ShmRing.h"
+#include "ServerMetrics.h"
+#include "ServerOptions.h"
+#include "TraceRecorder.h"
+#include "WorkerPool.h"
+
+#include <memory>
 
 class OcrServiceImpl : public ocr::OcrService::Service {
 public:
-    explicit OcrServiceImpl(int workerCount);
+    explicit OcrServiceImpl(const ServerOptions& options);
 
     grpc::Status RecognizeImage(
         grpc::ServerContext* context,
@@ -13,6 +26,116 @@ public:
         ocr::OcrResponse* response
     ) override;
 
+    // partial text per line/block as it is recognized, then a summary
+    grpc::Status RecognizeImageStream(
+        grpc::ServerContext* context,
+        const ocr::OcrRequest* request,
+        grpc::ServerWriter<ocr::OcrStreamMessage>* writer
+    ) override;
+
+    grpc::Status GetServerStats(
+        grpc::ServerContext* context,
+        const ocr::StatsRequest* request,
+        ocr::ServerStats* response
+    ) override;
+
+    grpc::Status DumpTrace(
+        grpc::ServerContext* context,
+        const ocr::TraceRequest* request,
+        ocr::TraceDump* response
+    ) override;
+
+    grpc::Status SetFaults(
+        grpc::ServerContext* context,
+        const ocr::FaultSpec* request,
+        ocr::FaultSpec* response
+    ) override;
+
+    // the trace timeline as Chrome trace JSON; false if tracing is off or
+    // the file can't be written
+    bool writeTrace(const std::string& path) const;
+
 private:
-    int workerCount_;
+    // validates the request and turns it into a job; not yet queued
+    grpc::Status buildJob(grpc::ServerContext* ctx, const ocr::OcrRequest& req,
+                          OcrJob& job);
+
+    // points the job at a client's shared-memory slot (Unix-socket peers only)
+    grpc::Status attachSharedImage(grpc::ServerContext* ctx,
+                                   const ocr::ShmSlot& slot, OcrJob& job);
+    void fillResponse(const ocr::OcrRequest& req, const OcrResult& result,
+                      ocr::OcrResponse* res);
+
+    // queuedUs / completedUs: RPC-side stage times, 0 if not reached.
+    // Also records the request in the trace, if on.
+    void fillTimings(const ocr::OcrRequest& req,
+                     std::chrono::steady_clock::time_point receivedAt,
+                     const StageTimes& stages,
+                     long long queuedUs, long long completedUs,
+                     ocr::OcrResponse* res);
+
+    // True if the request is settled without running OCR: a cached result,
+    // or (for a hash-only request) needs_image. res is filled either way.
+    bool answerFromCache(const ocr::OcrRequest& req, const OcrJob& job,
+                         ocr::OcrResponse* res);
+
+    // fills the job's expected cost from the cost model
+    void estimateCost(OcrJob& job);
+
+    // runs on a worker thread
+    OcrResult processJob(OcrJob& job);
+
+    // small enough, and in a mode where a stacked page reads the same
+    bool batchable(const OcrJob& job) const;
+
+    // recognizes the jobs as one composite page on a worker thread and
+    // fulfils each job's promise
+    void processBatch(std::vector<OcrJob>& jobs);
+
+    // one recognition pass on an engine for cfg; fills text/tier/confidence
+    // (segmentLevel set: also fills result.segments for streaming)
+    bool recognizeWith(const EngineConfig& cfg, PIX* pix,
+                       const PixRegion* region,
+                       const tesseract::PageIteratorLevel* segmentLevel,
+                       OcrResult& result);
+
+    // an injected stall: checks out the engine the job would start on and
+    // keeps it for stallUs, so the stall blocks that engine, not just the
+    // worker
+    void stallEngine(EngineConfig cfg, bool autoTier, long long stallUs);
+
+    // recognizeWith, through the fast-first cascade when it applies
+    bool recognizeTiered(EngineConfig cfg, bool autoTier, PIX* pix,
+                         const PixRegion* region,
+                         const tesseract::PageIteratorLevel* segmentLevel,
+                         OcrResult& result);
+
+    // Splits a large page into Tesseract's text blocks and recognizes them
+    // on this worker, plus any idle ones if recruitHelpers. Streaming jobs
+    // get each block's segments as soon as all blocks above it are done.
+    // False if the page has fewer than two blocks or none of them could be
+    // recognized; the page is then left to the caller.
+    struct SplitPage;
+    bool recognizeSplit(const EngineConfig& cfg, const OcrJob& job,
+                        PIX* pix, bool recruitHelpers, OcrResult& result);
+    void runSplitRegions(SplitPage& page);
+
+    ServerOptions options_;
+    ServerMetrics metrics_;
+    std::unique_ptr<EnginePool> engines_;
+    ShmMappingCache shmSegments_;
+    ResultCache resultCache_;
+    NearDupIndex nearDups_;
+    InFlightJobs inFlight_;
+    CostModel costModel_;
+    TraceRecorder trace_;
+    FaultInjector faults_;
+
+    // last, so they go first: workers use everything above, and the
+    // batcher's final flush still needs the pool
+    std::unique_ptr<WorkerPool> pool_;
+    std::unique_ptr<MicroBatcher> batcher_;
+
+    bool cascadeEnabled_ = false;
+    ModelTier accurateTier_ = ModelTier::Standard;
 };
@@ -0,0 +1,98 @@
+#include "PerceptualHash.h"
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+// cell means are kept in 1/16 gray levels
+static constexpr int kMeanScale = 16;
+
+// neighbours closer than this (2 gray levels) count as equal, so flat
+// background doesn't flip bits on every bit of JPEG or scanner noise
+static constexpr uint32_t kFlatMargin = 2 * kMeanScale;
+
+int PerceptualHash::distance(const PerceptualHash& other) const {
+    int d = 0;
+    for (size_t i = 0; i < bits.size(); i++) d += std::popcount(bits[i] ^ other.bits[i]);
+    return d;
+}
+
+bool PerceptualHash::similarShape(const PerceptualHash& other) const {
+    const double a = static_cast<double>(width) * other.height;
+    const double b = static_cast<double>(other.width) * height;
+    return a <= b * 1.1 && b <= a * 1.1;
+}
+
+bool perceptualHashGray(const uint8_t* data, int width, int height,
+                        size_t stride, bool byteSwapped, PerceptualHash& out) {
+    constexpr int cols = PerceptualHash::kColumns + 1;
+    constexpr int rows = PerceptualHash::kRows;
+    if (!data || width < cols || height < rows) return false;
+
+    // swapped rows are summed a whole word at a time and unswapped below
+    const size_t rowBytes = byteSwapped ? (static_cast<size_t>(width) + 3) & ~size_t(3)
+                                        : static_cast<size_t>(width);
+    if (stride < rowBytes) return false;
+
+    // Sum each band of rows into per-column totals first. The inner loop is
+    // a plain element-wise add over the row, which the compiler vectorizes;
+    // the cells are then cut from the column totals.
+    std::vector<uint32_t> colSum(rowBytes);
+    uint32_t mean[rows][cols];
+
+    for (int r = 0; r < rows; r++) {
+        const int y0 = r * height / rows;
+        const int y1 = (r + 1) * height / rows;
+
+        std::fill(colSum.begin(), colSum.end(), 0);
+        for (int y = y0; y < y1; y++) {
+            const uint8_t* line = data + static_cast<size_t>(y) * stride;
+            uint32_t* sum = colSum.data();
+            for (size_t i = 0; i < rowBytes; i++) sum[i] += line[i];
+        }
+
+        for (int c = 0; c < cols; c++) {
+            const int x0 = c * width / cols;
+            const int x1 = (c + 1) * width / cols;
+            uint64_t s = 0;
+            for (int x = x0; x < x1; x++) s += colSum[byteSwapped ? (x ^ 3) : x];
+
+            const uint64_t pixels = static_cast<uint64_t>(x1 - x0) * (y1 - y0);
+            mean[r][c] = static_cast<uint32_t>(s * kMeanScale / pixels);
+        }
+    }
+
+    out = PerceptualHash();
+    out.width = width;
+    out.height = height;
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < PerceptualHash::kColumns; c++) {
+            if (mean[r][c + 1] > mean[r][c] + kFlatMargin) {
+                const int bit = r * PerceptualHash::kColumns + c;
+                out.bits[bit >> 6] |= uint64_t(1) << (bit & 63);
+            }
+        }
+    }
+    return true;
+}
+
+bool perceptualHash(PIX* pix, PerceptualHash& out) {
+    if (!pix) return false;
+
+    PIX* gray = pixConvertTo8(pix, 0);
+    if (!gray) return false;
+
+    // Leptonica keeps 8-bit pixels big-endian within each 32-bit word
+#ifdef L_LITTLE_ENDIAN
+    const bool byteSwapped = true;
+#else
+    const bool byteSwapped = false;
+#endif
+
+    bool ok = perceptualHashGray(reinterpret_cast<const uint8_t*>(pixGetData(gray)),
+                                 pixGetWidth(gray), pixGetHeight(gray),
+                                 static_cast<size_t>(pixGetWpl(gray)) * 4,
+                                 byteSwapped, out);
+    pixDestroy(&gray);
+    return ok;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <leptonica/allheaders.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// 256-bit difference hash (dHash) of a page's look: the gray image is
+// averaged down to a 17x16 grid and each bit says whether a cell is
+// brighter than its left neighbour. Re-scans, recompressed JPEGs and
+// rescaled copies of one page land a few bits apart; different pages
+// land far apart. 256 bits rather than the usual 64 because text pages
+// differ in small details a 9x8 grid averages away.
+struct PerceptualHash {
+    static constexpr int kColumns = 16;     // bits per row (17 cells)
+    static constexpr int kRows = 16;
+
+    std::array<uint64_t, 4> bits{};
+    int width = 0;
+    int height = 0;
+
+    int distance(const PerceptualHash& other) const;
+
+    // aspect ratios within 10%; the grid hides the page's shape
+    bool similarShape(const PerceptualHash& other) const;
+};
+
+// Hashes 8-bit gray rows. byteSwapped: pixel x of a row is at x ^ 3, as
+// in Leptonica's big-endian-in-word layout on little-endian hosts.
+// False if the image is smaller than the grid.
+bool perceptualHashGray(const uint8_t* data, int width, int height,
+                        size_t stride, bool byteSwapped, PerceptualHash& out);
+
+// any depth; converts to 8-bit gray first
+bool perceptualHash(PIX* pix, PerceptualHash& out);
@@ -0,0 +1,150 @@
+#include "PixArena.h"
+
+#include <leptonica/allheaders.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+// smaller buffers (binarized strips, tiny crops) aren't worth keeping
+constexpr size_t kMinPooledBytes = 16 << 10;
+constexpr size_t kMaxCachedBuffers = 16;
+
+// a cached buffer is reused for a request up to 25% smaller than it
+constexpr size_t kMaxSlackDivisor = 4;
+
+// in front of every buffer, keeping the data 16-byte aligned like malloc
+struct alignas(16) BufferHeader {
+    size_t capacity;
+};
+
+std::atomic<bool> isInstalled{false};
+std::atomic<long long> allocations{0};
+std::atomic<long long> systemAllocations{0};
+std::atomic<long long> cachedBytes{0};
+
+struct ThreadCache {
+    size_t budget = 0;
+    size_t bytes = 0;
+    std::vector<BufferHeader*> buffers;     // oldest first
+
+    void clear() {
+        for (BufferHeader* b : buffers) std::free(b);
+        buffers.clear();
+        cachedBytes.fetch_sub(static_cast<long long>(bytes), std::memory_order_relaxed);
+        bytes = 0;
+    }
+};
+
+// plain pointer so frees after the owner below is gone still see nullptr
+thread_local ThreadCache* currentCache = nullptr;
+
+struct ThreadCacheOwner {
+    ThreadCache cache;
+    ~ThreadCacheOwner() {
+        currentCache = nullptr;
+        cache.clear();
+    }
+};
+thread_local ThreadCacheOwner cacheOwner;
+
+size_t roundUp(size_t n, size_t to) {
+    return (n + to - 1) / to * to;
+}
+
+void* allocate(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    ThreadCache* cache = currentCache;
+    if (cache && size >= kMinPooledBytes) {
+        // best fit among buffers not too much larger than asked for
+        size_t best = cache->buffers.size();
+        for (size_t i = 0; i < cache->buffers.size(); i++) {
+            size_t cap = cache->buffers[i]->capacity;
+            if (cap < size || cap - size > size / kMaxSlackDivisor) continue;
+            if (best == cache->buffers.size() || cap < cache->buffers[best]->capacity) best = i;
+        }
+        if (best != cache->buffers.size()) {
+            BufferHeader* header = cache->buffers[best];
+            cache->buffers.erase(cache->buffers.begin() + static_cast<long>(best));
+            cache->bytes -= header->capacity;
+            cachedBytes.fetch_sub(static_cast<long long>(header->capacity), std::memory_order_relaxed);
+            return header + 1;
+        }
+    }
+
+    // page-rounded so a slightly larger image next time still fits
+    size_t capacity = size >= kMinPooledBytes ? roundUp(size, 4096) : size;
+    auto* header = static_cast<BufferHeader*>(std::malloc(sizeof(BufferHeader) + capacity));
+    if (!header) return nullptr;
+    header->capacity = capacity;
+    systemAllocations.fetch_add(1, std::memory_order_relaxed);
+    return header + 1;
+}
+
+void deallocate(void* p) {
+    if (!p) return;
+    BufferHeader* header = static_cast<BufferHeader*>(p) - 1;
+
+    ThreadCache* cache = currentCache;
+    const size_t cap = header->capacity;
+    if (!cache || cap < kMinPooledBytes || cap > cache->budget) {
+        std::free(header);
+        return;
+    }
+
+    // make room by dropping the oldest buffers
+    while (!cache->buffers.empty() &&
+           (cache->bytes + cap > cache->budget || cache->buffers.size() >= kMaxCachedBuffers)) {
+        BufferHeader* oldest = cache->buffers.front();
+        cache->buffers.erase(cache->buffers.begin());
+        cache->bytes -= oldest->capacity;
+        cachedBytes.fetch_sub(static_cast<long long>(oldest->capacity), std::memory_order_relaxed);
+        std::free(oldest);
+    }
+
+    cache->buffers.push_back(header);
+    cache->bytes += cap;
+    cachedBytes.fetch_add(static_cast<long long>(cap), std::memory_order_relaxed);
+}
+
+} // namespace
+
+void PixArena::install() {
+    if (isInstalled.exchange(true)) return;
+    setPixMemoryManager(allocate, deallocate);
+}
+
+bool PixArena::installed() {
+    return isInstalled.load();
+}
+
+void PixArena::enableThreadCache(size_t budgetBytes) {
+    ThreadCache& cache = cacheOwner.cache;
+    if (budgetBytes == 0) {
+        currentCache = nullptr;
+        cache.clear();
+        cache.budget = 0;
+        return;
+    }
+    cache.budget = budgetBytes;
+    currentCache = &cache;
+}
+
+PixArena::Stats PixArena::stats() {
+    Stats s;
+    s.allocations = allocations.load(std::memory_order_relaxed);
+    s.systemAllocations = systemAllocations.load(std::memory_order_relaxed);
+    s.cachedBytes = cachedBytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+void PixArena::fill(ocr::ServerStats* out) {
+    Stats s = stats();
+    out->set_pix_allocations(s.allocations);
+    out->set_pix_system_allocations(s.systemAllocations);
+    out->set_pix_cached_bytes(s.cachedBytes);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ocr.pb.h"
+
+#include <cstddef>
+
+// Leptonica's pixel buffers, through per-thread free lists. A worker
+// decodes image after image of about the same size, so instead of handing
+// every buffer back to malloc (and contending on it with the other
+// workers), a worker keeps the buffers it frees and reuses one that fits
+// for its next PIX. Buffers may be freed on any thread; they join that
+// thread's list, or go back to malloc if it keeps none.
+class PixArena {
+public:
+    // Routes Leptonica's pixel allocations through here. Must run before
+    // the first PIX exists, since a buffer from plain malloc can't be
+    // freed through it; main() does this first thing.
+    static void install();
+    static bool installed();
+
+    // keep up to budgetBytes of freed buffers on the calling thread;
+    // 0 = none (every buffer straight from / back to malloc)
+    static void enableThreadCache(size_t budgetBytes);
+
+    struct Stats {
+        long long allocations = 0;          // buffers Leptonica asked for
+        long long systemAllocations = 0;    // of those, new from malloc
+        long long cachedBytes = 0;          // held in free lists right now
+    };
+    static Stats stats();
+
+    static void fill(ocr::ServerStats* out);
+};
@@ -0,0 +1,70 @@
+#include "ResultCache.h"
+
+ResultCache::ResultCache(size_t budgetBytes)
+    : budgetBytes_(budgetBytes)
+{}
+
+std::string ResultCache::key(const std::string& sha256, const OcrJob& job) {
+    return sha256 + settingsKey(job);
+}
+
+std::string ResultCache::settingsKey(const OcrJob& job) {
+    // the layout / cascade flags change the result as much as the config
+    std::string k = job.config.key();
+    k += job.autoLayout ? "|L" : "|-";
+    k += job.autoTier ? "T" : "-";
+    return k;
+}
+
+bool ResultCache::get(const std::string& key, OcrResult& out) {
+    if (!enabled()) return false;
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        misses_++;
+        return false;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+    out = it->second->result;
+    hits_++;
+    return true;
+}
+
+void ResultCache::put(const std::string& key, const OcrResult& result) {
+    if (!enabled() || !result.success) return;
+
+    OcrResult stored = result;
+    stored.segments.clear();
+    size_t bytes = sizeof(Entry) + key.size() * 2 + stored.text.size();
+    if (bytes > budgetBytes_) return;
+
+    std::lock_guard<std::mutex> lock(mtx_);
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        totalBytes_ -= it->second->bytes;
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    lru_.push_front(Entry{key, std::move(stored), bytes});
+    index_[key] = lru_.begin();
+    totalBytes_ += bytes;
+
+    while (totalBytes_ > budgetBytes_) {
+        Entry& victim = lru_.back();
+        totalBytes_ -= victim.bytes;
+        index_.erase(victim.key);
+        lru_.pop_back();
+    }
+}
+
+void ResultCache::fill(ocr::ServerStats* out) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    out->set_result_cache_hits(hits_);
+    out->set_result_cache_misses(misses_);
+    out->set_result_cache_entries(static_cast<long long>(lru_.size()));
+    out->set_result_cache_bytes(static_cast<long long>(totalBytes_));
+}
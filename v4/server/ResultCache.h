@@ -0,0 +1,48 @@
+#pragma once
+
+#include "OcrJob.h"
+#include "ocr.pb.h"
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Finished results keyed by image content hash + the settings that produced
+// them, so a client can ask by hash before uploading (hash-first handshake).
+// Least recently used entries go once the text held exceeds the budget.
+class ResultCache {
+public:
+    // budgetBytes = 0 disables the cache
+    explicit ResultCache(size_t budgetBytes);
+
+    bool enabled() const { return budgetBytes_ > 0; }
+
+    // sha256 is the raw 32-byte digest
+    static std::string key(const std::string& sha256, const OcrJob& job);
+
+    // everything besides the image that decides the result
+    static std::string settingsKey(const OcrJob& job);
+
+    bool get(const std::string& key, OcrResult& out);
+    void put(const std::string& key, const OcrResult& result);
+
+    void fill(ocr::ServerStats* out);
+
+private:
+    struct Entry {
+        std::string key;
+        OcrResult result;
+        size_t bytes;
+    };
+
+    size_t budgetBytes_;
+
+    std::mutex mtx_;
+    std::list<Entry> lru_;      // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    size_t totalBytes_ = 0;
+    long long hits_ = 0;
+    long long misses_ = 0;
+};
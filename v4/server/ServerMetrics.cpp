@@ -0,0 +1,44 @@
+#include "ServerMetrics.h"
+
+void LatencyCounter::record(long long us) {
+    count_.fetch_add(1, std::memory_order_relaxed);
+    totalUs_.fetch_add(us, std::memory_order_relaxed);
+
+    long long prev = maxUs_.load(std::memory_order_relaxed);
+    while (us > prev && !maxUs_.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {}
+}
+
+void LatencyCounter::fill(ocr::LatencyStats* out) const {
+    long long n = count_.load(std::memory_order_relaxed);
+    out->set_count(n);
+    out->set_mean_ms(n > 0 ? totalUs_.load(std::memory_order_relaxed) / 1000.0 / n : 0.0);
+    out->set_max_ms(maxUs_.load(std::memory_order_relaxed) / 1000.0);
+}
+
+void ServerMetrics::fill(ocr::ServerStats* out) const {
+    const LayoutClass classes[] = {
+        LayoutClass::SingleWord, LayoutClass::SingleLine, LayoutClass::MultiLine
+    };
+    for (LayoutClass c : classes) {
+        auto* mode = out->add_layout_modes();
+        mode->set_mode(layoutClassName(c));
+        layoutRecognize[static_cast<int>(c)].fill(mode->mutable_recognize());
+    }
+    layoutClassify.fill(out->mutable_layout_classify());
+    out->set_layout_bypassed(layoutBypassed.load(std::memory_order_relaxed));
+
+    out->set_cascade_fast_accepted(cascadeFastAccepted.load(std::memory_order_relaxed));
+    out->set_cascade_escalated(cascadeEscalated.load(std::memory_order_relaxed));
+    cascadeFast.fill(out->mutable_cascade_fast());
+    cascadeAccurate.fill(out->mutable_cascade_accurate());
+
+    out->set_split_pages(splitPages.load(std::memory_order_relaxed));
+    out->set_split_regions(splitRegions.load(std::memory_order_relaxed));
+    out->set_split_helpers(splitHelpers.load(std::memory_order_relaxed));
+    splitLayout.fill(out->mutable_split_layout());
+
+    out->set_shm_requests(sharedMemoryRequests.load(std::memory_order_relaxed));
+    out->set_coalesced_requests(coalescedRequests.load(std::memory_order_relaxed));
+    out->set_micro_batches(microBatches.load(std::memory_order_relaxed));
+    out->set_micro_batched_images(microBatchedImages.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "LayoutClassifier.h"
+#include "ocr.pb.h"
+
+#include <atomic>
+
+// count / mean / max of one latency, safe to record from any worker
+class LatencyCounter {
+public:
+    void record(long long us);
+    void fill(ocr::LatencyStats* out) const;
+
+private:
+    std::atomic<long long> count_{0};
+    std::atomic<long long> totalUs_{0};
+    std::atomic<long long> maxUs_{0};
+};
+
+// counters served by the GetServerStats RPC
+class ServerMetrics {
+public:
+    // recognize latency per layout class the classifier picked
+    LatencyCounter layoutRecognize[3];
+    LatencyCounter layoutClassify;
+    std::atomic<long long> layoutBypassed{0};
+
+    std::atomic<long long> cascadeFastAccepted{0};
+    std::atomic<long long> cascadeEscalated{0};
+    LatencyCounter cascadeFast;
+    LatencyCounter cascadeAccurate;
+
+    std::atomic<long long> splitPages{0};
+    std::atomic<long long> splitRegions{0};
+    std::atomic<long long> splitHelpers{0};
+    LatencyCounter splitLayout;
+
+    std::atomic<long long> sharedMemoryRequests{0};
+    std::atomic<long long> coalescedRequests{0};
+
+    std::atomic<long long> microBatches{0};
+    std::atomic<long long> microBatchedImages{0};
+
+    void fill(ocr::ServerStats* out) const;
+};
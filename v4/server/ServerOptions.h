@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// runtime settings, filled from the command line in main.cpp
+struct ServerOptions {
+    std::string address = "0.0.0.0:50051";
+
+    // also listen on this Unix socket; clients connecting through it may
+    // pass images in shared memory. empty = TCP only
+    std::string unixSocket;
+    int workers = 8;
+
+    // order the queue by expected cost (with aging) instead of arrival
+    bool shortestFirst = true;
+
+    // tessdata folder; empty = TESSDATA_PREFIX / Homebrew lookup
+    std::string tessdataDir;
+
+    // profiles whose engines are created at startup, one per worker
+    std::vector<std::string> prewarmProfiles = {"default"};
+
+    // model folders for the fast / best tiers (empty = not available)
+    std::string tessdataFastDir;
+    std::string tessdataBestDir;
+
+    // recognize with the fast tier first and re-run on the accurate tier
+    // (best if available, else standard) only below cascadeThreshold
+    bool cascade = false;
+    int cascadeThreshold = 80;
+
+    // pages with at least this many pixels are split into text blocks
+    // recognized by several workers at once; 0 = off
+    long long splitMinPixels = 0;
+
+    // estimated memory idle engines may hold before the least recently
+    // used are evicted; 0 = unlimited
+    size_t engineMemoryBudgetMb = 1024;
+
+    // text of finished results kept by content hash, so repeated images
+    // (and hash-first requests) skip OCR and upload; 0 = off. costs a
+    // SHA-256 of every inline image on the RPC thread
+    size_t resultCacheMb = 0;
+
+    // reuse the result of an earlier image whose perceptual hash is within
+    // this many bits (of 256), for re-scans and recompressed copies;
+    // -1 = off. ~24 matches most re-encodes without mixing up pages
+    int nearDupDistance = -1;
+    size_t nearDupEntries = 4096;
+
+    // identical requests in flight at once share one OCR run; like the
+    // result cache, hashes every inline image on the RPC thread
+    bool coalesce = false;
+
+    // freed image buffers the workers keep to decode the next image into,
+    // instead of going back to malloc; a total, split evenly between the
+    // workers. 0 = plain malloc (and Leptonica's allocator left alone)
+    size_t pixCacheMb = 0;
+
+    // hold images no taller than microBatchMaxHeight for up to
+    // microBatchMs and recognize up to microBatchMax of them stacked on
+    // one page; 0 ms = off
+    int microBatchMs = 0;
+    int microBatchMax = 16;
+    int microBatchMaxHeight = 120;
+
+    // spans of recent requests kept for the DumpTrace timeline; 0 = off.
+    // with traceFile, the timeline is also written there on shutdown
+    size_t traceEvents = 0;
+    std::string traceFile;
+
+    // injected latency / failures for testing clients (FaultInjector.h);
+    // empty = none. faultRpc lets clients change them with SetFaults
+    std::string faults;
+    bool faultRpc = false;
+
+    // route requests that don't pin a mode through the layout classifier
+    bool autoLayout = false;
+};
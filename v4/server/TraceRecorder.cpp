@@ -0,0 +1,188 @@
+#include "TraceRecorder.h"
+#include "JsonString.h"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+static size_t roundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+static long long usSince(std::chrono::steady_clock::time_point epoch,
+                         std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t - epoch).count();
+}
+
+TraceRecorder::TraceRecorder(size_t capacity)
+    : capacity_(capacity > 0 ? roundUpPow2(capacity) : 0),
+      epoch_(std::chrono::steady_clock::now())
+{
+    if (capacity_ > 0) slots_.reset(new Slot[capacity_]);
+}
+
+long long TraceRecorder::dropped() const {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    return head > capacity_ ? static_cast<long long>(head - capacity_) : 0;
+}
+
+void TraceRecorder::recordRequest(std::string_view filename,
+                                  std::chrono::steady_clock::time_point receivedAt,
+                                  const StageTimes& stages,
+                                  long long queuedUs, long long completedUs,
+                                  long long respondedUs) {
+    if (!enabled()) return;
+
+    const long long base = usSince(epoch_, receivedAt);
+
+    Span spans[6];
+    int n = 0;
+    spans[n++] = {Kind::Request, base, respondedUs, -1};
+    if (stages.dequeuedUs > 0) {
+        const int w = stages.workerId;
+        spans[n++] = {Kind::Queue, base + queuedUs, stages.dequeuedUs - queuedUs, -1};
+        spans[n++] = {Kind::Decode, base + stages.dequeuedUs,
+                      stages.decodedUs - stages.dequeuedUs, w};
+        if (stages.recognizedUs > 0) {
+            spans[n++] = {Kind::Recognize, base + stages.decodedUs,
+                          stages.recognizedUs - stages.decodedUs, w};
+        }
+        if (stages.delayDoneUs > stages.recognizedUs && stages.recognizedUs > 0) {
+            spans[n++] = {Kind::Delay, base + stages.recognizedUs,
+                          stages.delayDoneUs - stages.recognizedUs, w};
+        }
+    }
+    if (completedUs > 0) {
+        spans[n++] = {Kind::Respond, base + completedUs, respondedUs - completedUs, -1};
+    }
+
+    // the file name, cut to fit without splitting a UTF-8 sequence
+    uint64_t label[kLabelWords] = {};
+    size_t len = std::min(filename.size(), sizeof(label) - 1);
+    while (len > 0 && len < filename.size() &&
+           (static_cast<unsigned char>(filename[len]) & 0xC0) == 0x80) {
+        len--;
+    }
+    std::memcpy(label, filename.data(), len);
+
+    const uint64_t requestId = nextRequestId_.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t first = head_.fetch_add(n, std::memory_order_relaxed);
+    for (int i = 0; i < n; i++) write(first + i, requestId, spans[i], label);
+}
+
+void TraceRecorder::write(uint64_t index, uint64_t requestId, const Span& span,
+                          const uint64_t (&label)[kLabelWords]) {
+    Slot& slot = slots_[index & (capacity_ - 1)];
+
+    // seq 0 marks the slot as being written
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.startUs.store(span.startUs, std::memory_order_relaxed);
+    slot.durUs.store(std::max(0LL, span.durUs), std::memory_order_relaxed);
+    slot.requestId.store(requestId, std::memory_order_relaxed);
+    slot.kind.store(static_cast<uint32_t>(span.kind), std::memory_order_relaxed);
+    slot.workerId.store(span.workerId, std::memory_order_relaxed);
+    for (size_t i = 0; i < kLabelWords; i++) {
+        slot.label[i].store(label[i], std::memory_order_relaxed);
+    }
+
+    slot.seq.store(index + 1, std::memory_order_release);
+}
+
+void TraceRecorder::writeChromeTrace(std::ostream& out) const {
+    struct Event {
+        Kind kind;
+        long long startUs;
+        long long durUs;
+        uint64_t requestId;
+        int workerId;
+        char label[kLabelWords * 8];
+    };
+
+    std::vector<Event> events;
+    std::set<int> workers;
+
+    const uint64_t head = enabled() ? head_.load(std::memory_order_acquire) : 0;
+    const uint64_t oldest = head > capacity_ ? head - capacity_ : 0;
+    events.reserve(head - oldest);
+
+    for (uint64_t index = oldest; index < head; index++) {
+        const Slot& slot = slots_[index & (capacity_ - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != index + 1) continue;
+
+        Event e;
+        e.kind = static_cast<Kind>(slot.kind.load(std::memory_order_relaxed));
+        e.startUs = slot.startUs.load(std::memory_order_relaxed);
+        e.durUs = slot.durUs.load(std::memory_order_relaxed);
+        e.requestId = slot.requestId.load(std::memory_order_relaxed);
+        e.workerId = slot.workerId.load(std::memory_order_relaxed);
+        uint64_t label[kLabelWords];
+        for (size_t i = 0; i < kLabelWords; i++) {
+            label[i] = slot.label[i].load(std::memory_order_relaxed);
+        }
+        std::memcpy(e.label, label, sizeof(label));
+        e.label[sizeof(e.label) - 1] = '\0';
+
+        // overwritten while we read it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != index + 1) continue;
+
+        if (e.workerId >= 0) workers.insert(e.workerId);
+        events.push_back(e);
+    }
+
+    // workers on tids 1.., requests on async tracks of their own
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    json += "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"ocr_server\"}}";
+    for (int w : workers) {
+        json += ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(w + 1) +
+                ",\"name\":\"thread_name\",\"args\":{\"name\":\"worker " +
+                std::to_string(w) + "\"}}";
+    }
+
+    for (const Event& e : events) {
+        const std::string id = std::to_string(e.requestId);
+        const std::string ts = std::to_string(e.startUs);
+        const std::string end = std::to_string(e.startUs + e.durUs);
+
+        switch (e.kind) {
+        case Kind::Request:
+        case Kind::Queue:
+        case Kind::Respond: {
+            std::string name;
+            if (e.kind == Kind::Request) name = e.label;
+            else name = e.kind == Kind::Queue ? "queue" : "respond";
+
+            json += ",\n{\"ph\":\"b\",\"cat\":\"request\",\"pid\":1,\"id\":" + id +
+                    ",\"ts\":" + ts + ",\"name\":";
+            appendJsonString(json, name);
+            json += "}";
+            json += ",\n{\"ph\":\"e\",\"cat\":\"request\",\"pid\":1,\"id\":" + id +
+                    ",\"ts\":" + end + ",\"name\":";
+            appendJsonString(json, name);
+            json += "}";
+            break;
+        }
+        case Kind::Decode:
+        case Kind::Recognize:
+        case Kind::Delay: {
+            const char* name = e.kind == Kind::Decode ? "decode"
+                             : e.kind == Kind::Recognize ? "recognize" : "injected delay";
+            json += ",\n{\"ph\":\"X\",\"cat\":\"worker\",\"pid\":1,\"tid\":" +
+                    std::to_string(e.workerId + 1) + ",\"ts\":" + ts +
+                    ",\"dur\":" + std::to_string(e.durUs) +
+                    ",\"name\":\"" + name + "\",\"args\":{\"request\":" + id + ",\"file\":";
+            appendJsonString(json, e.label);
+            json += "}}";
+            break;
+        }
+        }
+    }
+    json += "\n]}\n";
+    out << json;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "OcrJob.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string_view>
+
+// Timeline of recent requests for Chrome's trace viewer / Perfetto.
+// Each finished request is written as a handful of spans into a
+// fixed-size ring: the request itself, its queue wait and response on a
+// per-request async track, and its decode / recognize / injected delay
+// on the track of the worker that ran it, so idle and stuck workers show
+// up as gaps and long bars. Writers only claim slots with one fetch_add and
+// never wait; once full, the oldest spans are overwritten.
+class TraceRecorder {
+public:
+    // capacity in spans, rounded up to a power of two; 0 = off
+    explicit TraceRecorder(size_t capacity);
+
+    bool enabled() const { return capacity_ > 0; }
+
+    // A request that finished; times are µs after receivedAt, 0 for
+    // stages it never reached (a cache hit has only the request span).
+    void recordRequest(std::string_view filename,
+                       std::chrono::steady_clock::time_point receivedAt,
+                       const StageTimes& stages,
+                       long long queuedUs, long long completedUs,
+                       long long respondedUs);
+
+    // Chrome trace-event JSON of the spans still in the ring
+    void writeChromeTrace(std::ostream& out) const;
+
+    long long recorded() const { return head_.load(std::memory_order_relaxed); }
+    long long dropped() const;
+
+private:
+    enum class Kind : uint8_t { Request, Queue, Respond, Decode, Recognize, Delay };
+
+    static constexpr size_t kLabelWords = 4;    // filename, up to 31 bytes
+
+    // every field atomic so a reader racing a writer sees a torn slot
+    // (and skips it by seq) rather than undefined behaviour
+    struct Slot {
+        std::atomic<uint64_t> seq{0};           // index + 1 once written
+        std::atomic<int64_t> startUs{0};
+        std::atomic<int64_t> durUs{0};
+        std::atomic<uint64_t> requestId{0};
+        std::atomic<uint32_t> kind{0};
+        std::atomic<int32_t> workerId{0};
+        std::array<std::atomic<uint64_t>, kLabelWords> label{};
+    };
+
+    struct Span {
+        Kind kind;
+        long long startUs;
+        long long durUs;
+        int workerId;
+    };
+
+    void write(uint64_t index, uint64_t requestId, const Span& span,
+               const uint64_t (&label)[kLabelWords]);
+
+    size_t capacity_ = 0;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> nextRequestId_{1};
+    std::chrono::steady_clock::time_point epoch_;
+};
@@ -0,0 +1,73 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+static thread_local int tlsWorkerId = -1;
+
+int WorkerPool::currentWorkerId() {
+    return tlsWorkerId;
+}
+
+WorkerPool::WorkerPool(int n, HandlerFactory factory, bool shortestFirst)
+    : factory_(std::move(factory)), queue_(shortestFirst)
+{
+    for (int i = 0; i < n; i++) {
+        workers_.emplace_back(&WorkerPool::workerLoop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    queue_.stop();
+
+    for (auto &t : workers_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+long long WorkerPool::pushJob(OcrJob job) {
+    const long long own = job.expectedCostUs;
+
+    // running jobs are taken to be half done, on average
+    long long ahead = queue_.push(std::move(job)) +
+                      runningCostUs_.load(std::memory_order_relaxed) / 2;
+    return ahead / std::max(1, size()) + own;
+}
+
+long long WorkerPool::backlogUs() const {
+    long long work = queue_.queuedCostUs() + runningCostUs_.load(std::memory_order_relaxed) / 2;
+    return work / std::max(1, size());
+}
+
+void WorkerPool::pushUrgent(OcrJob job) {
+    queue_.pushFront(std::move(job));
+}
+
+void WorkerPool::workerLoop(int workerId) {
+    tlsWorkerId = workerId;
+    JobHandler handler = factory_(workerId);
+
+    while (auto job = queue_.pop()) {
+        busy_++;
+        const long long cost = job->expectedCostUs;
+        runningCostUs_ += cost;
+
+        OcrResult result;
+        try {
+            if (job->task) {
+                job->task();
+            } else {
+                result = handler(*job);
+            }
+        } catch (const std::exception& ex) {
+            std::cerr << "[Worker " << workerId << "] Exception: " << ex.what() << "\n";
+            result.success = false;
+            result.error = "OCR failed";
+        }
+
+        if (job->done) job->done->set_value(std::move(result));
+        runningCostUs_ -= cost;
+        busy_--;
+    }
+}
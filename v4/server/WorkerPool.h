@@ -0,0 +1,54 @@
+#pragma once
+
+#include "JobQueue.h"
+#include "OcrJob.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// fixed set of threads draining one JobQueue
+class WorkerPool {
+public:
+    using JobHandler = std::function<OcrResult(OcrJob&)>;
+
+    // called once on each worker thread, so per-worker state
+    // (e.g. the Tesseract engine) is created and used on that thread
+    using HandlerFactory = std::function<JobHandler(int workerId)>;
+
+    // shortestFirst: see JobQueue
+    WorkerPool(int n, HandlerFactory factory, bool shortestFirst = false);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // returns when the job is expected to finish, in microseconds from
+    // now, going by the expected cost of everything queued before it (an
+    // estimate with shortest-first, which reorders the queue both ways)
+    long long pushJob(OcrJob job);
+
+    // ahead of everything queued, for tasks a running job waits on
+    void pushUrgent(OcrJob job);
+
+    int size() const { return static_cast<int>(workers_.size()); }
+
+    // workers currently waiting for a job (a snapshot, may change at once)
+    int idleWorkers() const { return size() - busy_.load(std::memory_order_relaxed); }
+
+    // expected time until a worker frees up for a job queued now
+    long long backlogUs() const;
+
+    // id of the worker running the calling thread, -1 off the pool
+    static int currentWorkerId();
+
+private:
+    void workerLoop(int workerId);
+
+    HandlerFactory factory_;
+    std::vector<std::thread> workers_;
+    JobQueue queue_;
+    std::atomic<int> busy_{0};
+    std::atomic<long long> runningCostUs_{0};   // expected cost of jobs being run
+};
@@ -7,7 +7,23 @@
 
 // # terminal 1
 // cd server
-// ./ocr_server
+// ./ocr_server [--workers N] [--address host:port] [--tessdata DIR]
+//              [--unix-socket PATH]
+//              [--prewarm default,line,...] [--auto-layout]
+//              [--engine-memory-mb N]
+//              [--tessdata-fast DIR] [--tessdata-best DIR]
+//              [--cascade] [--cascade-threshold N]
+//              [--split-min-mpix N] [--result-cache-mb N]
+//              [--near-dup-distance N] [--near-dup-entries N]
+//              [--coalesce] [--pix-cache-mb N]
+//              [--micro-batch-ms N] [--micro-batch-max N]
+//              [--micro-batch-max-height N] [--fifo]
+//              [--trace-events N] [--trace-file PATH]
+//              [--faults SPEC] [--allow-fault-rpc]
+//
+// --faults injects latency / failures for testing clients, e.g.
+// "delay=fixed:1000" for the old one-second demo delay per job; see
+// FaultInjector.h for the spec. off by default
 
 
 // # terminal 2
@@ -15,30 +31,176 @@
 // ./ocr_client
 
 #include <grpcpp/grpcpp.h>
+#include "FaultInjector.h"
 #include "OcrServiceImpl.h"
+#include "PixArena.h"
+#include "ServerOptions.h"
+#include <algorithm>
+#include <cstdlib>
+#include <csignal>
 #include <iostream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
 
-int main() {
-    const std::string lanIP = "192.168.1.12";
-    const std::string address = "0.0.0.0:50051";
+// spans kept when only --trace-file is given (~64 bytes each)
+static constexpr size_t kDefaultTraceEvents = 1 << 16;
+
+// splits "a,b,c"
+static std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+static bool parseArgs(int argc, char** argv, ServerOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (arg == "--workers" && value) {
+            opt.workers = std::max(1, std::atoi(value)); i++;
+        } else if (arg == "--address" && value) {
+            opt.address = value; i++;
+        } else if (arg == "--unix-socket" && value) {
+            opt.unixSocket = value; i++;
+        } else if (arg == "--tessdata" && value) {
+            opt.tessdataDir = value; i++;
+        } else if (arg == "--prewarm" && value) {
+            opt.prewarmProfiles = splitList(value); i++;
+        } else if (arg == "--engine-memory-mb" && value) {
+            opt.engineMemoryBudgetMb = std::strtoull(value, nullptr, 10); i++;
+        } else if (arg == "--tessdata-fast" && value) {
+            opt.tessdataFastDir = value; i++;
+        } else if (arg == "--tessdata-best" && value) {
+            opt.tessdataBestDir = value; i++;
+        } else if (arg == "--cascade") {
+            opt.cascade = true;
+        } else if (arg == "--cascade-threshold" && value) {
+            opt.cascade = true;
+            opt.cascadeThreshold = std::atoi(value); i++;
+        } else if (arg == "--split-min-mpix" && value) {
+            opt.splitMinPixels = static_cast<long long>(std::atof(value) * 1000000); i++;
+        } else if (arg == "--result-cache-mb" && value) {
+            opt.resultCacheMb = std::strtoull(value, nullptr, 10); i++;
+        } else if (arg == "--near-dup-distance" && value) {
+            opt.nearDupDistance = std::atoi(value); i++;
+        } else if (arg == "--near-dup-entries" && value) {
+            opt.nearDupEntries = std::strtoull(value, nullptr, 10); i++;
+        } else if (arg == "--pix-cache-mb" && value) {
+            opt.pixCacheMb = std::strtoull(value, nullptr, 10); i++;
+        } else if (arg == "--micro-batch-ms" && value) {
+            opt.microBatchMs = std::max(0, std::atoi(value)); i++;
+        } else if (arg == "--micro-batch-max" && value) {
+            opt.microBatchMax = std::max(1, std::atoi(value)); i++;
+        } else if (arg == "--micro-batch-max-height" && value) {
+            opt.microBatchMaxHeight = std::max(1, std::atoi(value)); i++;
+        } else if (arg == "--trace-events" && value) {
+            opt.traceEvents = std::strtoull(value, nullptr, 10); i++;
+        } else if (arg == "--trace-file" && value) {
+            opt.traceFile = value; i++;
+        } else if (arg == "--faults" && value) {
+            FaultInjector::Config cfg;
+            std::string error;
+            if (!FaultInjector::parse(value, cfg, error)) {
+                std::cerr << "[Server] " << error << std::endl;
+                return false;
+            }
+            opt.faults = value; i++;
+        } else if (arg == "--allow-fault-rpc") {
+            opt.faultRpc = true;
+        } else if (arg == "--fifo") {
+            opt.shortestFirst = false;
+        } else if (arg == "--coalesce") {
+            opt.coalesce = true;
+        } else if (arg == "--auto-layout") {
+            opt.autoLayout = true;
+        } else {
+            std::cerr << "[Server] Unknown or incomplete option: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (!opt.traceFile.empty() && opt.traceEvents == 0) {
+        opt.traceEvents = kDefaultTraceEvents;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    if (!parseArgs(argc, argv, options)) return 2;
+
+    // before anything (e.g. engine prewarming) creates a PIX
+    if (options.pixCacheMb > 0) PixArena::install();
+
+    // with a trace file, Ctrl-C / SIGTERM stop the server cleanly so the
+    // timeline can be written. blocked before any thread starts, so only
+    // the thread waiting for them below sees them
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    if (!options.traceFile.empty()) pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
 
     std::cout << "[Server] Initializing OCR Service..." << std::endl;
-    OcrServiceImpl service(8);   // 8 worker threads
+    OcrServiceImpl service(options);
 
     grpc::ServerBuilder builder;
-    builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+    int boundPort = 0;
+    builder.AddListeningPort(options.address, grpc::InsecureServerCredentials(), &boundPort);
+    if (!options.unixSocket.empty()) {
+        // a socket file left by a previous run would make the bind fail
+        ::unlink(options.unixSocket.c_str());
+        builder.AddListeningPort("unix:" + options.unixSocket,
+                                 grpc::InsecureServerCredentials());
+    }
     builder.RegisterService(&service);
 
-    std::cout << "[Server] Starting server with 8 worker threads..." << std::endl;
+    std::cout << "[Server] Starting server with " << options.workers
+              << " worker threads..." << std::endl;
 
     std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
+    if (!server || boundPort == 0) {
+        std::cerr << "[Server] Could not listen on " << options.address << std::endl;
+        return 1;
+    }
+
+    // host as given, port as bound (they differ for "host:0")
+    const std::string host = options.address.substr(0, options.address.rfind(':'));
+    const bool anyInterface = host == "0.0.0.0" || host == "[::]" || host.empty();
 
     std::cout << "[Server] Server is now running." << std::endl;
-    std::cout << "[Server] Server reachable at: " 
-          << lanIP << ":50051" << std::endl;
+    std::cout << "[Server] Listening on " << host << ":" << boundPort
+              << (anyInterface ? " (all interfaces)" : "") << std::endl;
+    if (!options.unixSocket.empty()) {
+        std::cout << "[Server] Local clients: unix:" << options.unixSocket
+                  << " (shared memory enabled)" << std::endl;
+    }
     std::cout << "[Server] Waiting for client connections..." << std::endl;
 
+    std::thread stopper;
+    if (!options.traceFile.empty()) {
+        stopper = std::thread([&] {
+            int sig = 0;
+            sigwait(&stopSignals, &sig);
+            std::cout << "[Server] Shutting down..." << std::endl;
+            server->Shutdown();
+        });
+    }
+
     server->Wait();
+
+    if (stopper.joinable()) {
+        stopper.join();
+        if (service.writeTrace(options.traceFile)) {
+            std::cout << "[Server] Trace written to " << options.traceFile << std::endl;
+        } else {
+            std::cerr << "[Server] Cannot write trace to " << options.traceFile << std::endl;
+        }
+    }
     return 0;
 }
-